@@ -0,0 +1,908 @@
+#ifndef CLASS_BURGERSCORE
+#define CLASS_BURGERSCORE
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include "BLAS_Wrapper.h"
+#include "GridMetric.h"
+#include "ImplicitSolver.h"
+#include "InitialCondition.h"
+#include "Options.h"
+#include "PatchHierarchy.h"
+
+/**
+ * @class BurgersCore
+ * @brief Creates a Burgers instance that does computations on Burger's equation, over the part
+ * of the grid owned by a decomposition policy D. The stencil, the time integrators, the initial
+ * profiles and the energy are written once here; D supplies:
+ *  - ModelType, Line: the Model class and the ADI line operator of the build
+ *  - D(Model&, registers): the field arena of (U,V) registers, GetStorage(), GetCellSize(),
+ *    GetU(r), GetV(r), and the local sub-matrix GetNxr(), GetNyr() at global offset
+ *    GetDisplX(), GetDisplY()
+ *  - OVERLAP, Start(r), Finish(), Release(): halo exchange of register r (OVERLAP: whether there
+ *    are halos to hide behind the interior; without, Start(r) still fills periodic ghosts), and
+ *    the wait before a register is overwritten
+ *  - SumAll, MaxAll, MinAll: in-place reductions over the decomposition; IsRoot() for messages
+ *  - ExchangeFaces(send, recv, count): one buffer to and from every halo neighbour, for the
+ *    fine edges of the refined patches (see PatchHierarchy)
+ *  - SumOfSquares(U, V), WriteVelocityFile(U, V): energy sum and output of the whole grid;
+ *    SumOfSquares(U, V, wx, wy) weights column i by wx[i] and row j by wy[j]
+ *  - NewLineX(), NewLineY(): ADI line operators along x and y
+ *  - BeginWork(), EndWork(), GetRebalanceInterval(), Repartition(r): measured compute time and
+ *    the repartition it drives, moving register r to register 0 of a new arena
+ * A single-domain policy implements the exchanges and reductions as empty inline functions,
+ * so the compiler removes them
+ * @tparam D decomposition policy
+ * */
+template <class D>
+class BurgersCore {
+public:
+    typedef typename D::ModelType Model;
+
+    explicit BurgersCore(Model &m);
+    ~BurgersCore();
+
+    void Reset();
+    void SetInitialVelocity();
+    void SetIntegratedVelocity();
+    int  Step(int n);
+    void WriteVelocityFile();
+    void SetEnergy();
+    double GetE()     const { return E; }
+    int    GetSteps() const { return steps; }
+    double GetTime()  const { return t; }
+    bool   IsFinished() const { return finished; }
+    int    GetSolverIterations() const { return solverIterations; }
+
+    /// Zero-copy read access to the local fields, valid until the next Step(): cell (i,j) of the
+    /// sub-matrix (column i, row j, global cell (GetDisplX() + i, GetDisplY() + j)) is
+    /// GetU()[i*GetColumnStride() + j*GetCellSize()], and likewise for V
+    const double* GetU() const { return U; }
+    const double* GetV() const { return V; }
+    int GetCellSize()     const { return cs; }
+    int GetColumnStride() const { return cs*ld; }
+    int GetNxr()   const { return decomp.GetNxr(); }
+    int GetNyr()   const { return decomp.GetNyr(); }
+    int GetDisplX() const { return decomp.GetDisplX(); }
+    int GetDisplY() const { return decomp.GetDisplY(); }
+private:
+    /**
+     * @brief One explicit stage, cell by cell: out = a*acc + b*in + c*dt*L(in), where L is the
+     * advection-diffusion operator of the selected stencil (upwind or fourth-order central).
+     * acc may be out (it is only read at the written cell)
+     * */
+    struct Stage {
+        const double* inU;
+        const double* inV;
+        const double* accU;
+        const double* accV;
+        double* outU;
+        double* outV;
+        double a;
+        double b;
+        double c;
+    };
+
+    /// Stage updates: EULER out = in + dt*L(in), BLEND as in Stage, ACCUMULATE the same with
+    /// acc = out, which keeps the in-place stages free of runtime aliasing checks
+    enum StageMode { EULER, BLEND, ACCUMULATE };
+
+    static int Registers(const Model &m);
+    template <class P> void SetProfile(const P &p);
+    void BeginIntegration();
+    template <bool TRACK> void Advance();
+    void AdvanceRefined();
+    template <bool TRACK> void StepSSP();
+    void StepLowStorage();
+    void StepImplicit();
+    template <bool TRACK, StageMode MODE> void Sweep(const Stage &s, int r);
+    template <int CS, int H, bool STRETCHED, bool TRACK, StageMode MODE> void SweepNextVelocities(const Stage &s, int r);
+    template <int CS, int H, bool STRETCHED, bool TRACK, StageMode MODE>
+    void ComputeNextVelocityState(const Stage &s, int i0, int i1, int j0, int j1);
+    void SetMaxVelocities();
+    void ReduceMaxVelocities();
+    void SetActiveRegion();
+    void GrowActiveRegion();
+    void SetFields();
+    void Rebalance();
+    void DiffuseImplicit();
+
+    /// Burger parameters
+    Model* model;
+    double* U;
+    double* V;
+    double* NextU;
+    double* NextV;
+    double E;
+
+    /// Time steps taken, time reached, and largest |U|, |V| of the current fields (adaptive time step)
+    /// started: the integration from the initial velocity has begun; finished: it has reached T
+    int steps;
+    double t;
+    double maxU;
+    double maxV;
+    bool started;
+    bool finished;
+
+    /// Active region in global interior indices, the same on every rank: every field is exactly
+    /// zero outside columns [activeX0, activeX1) and rows [activeY0, activeY1); an explicit stage
+    /// widens it by the reach of the stencil (one cell upwind, two central)
+    int activeX0;
+    int activeX1;
+    int activeY0;
+    int activeY1;
+
+    /// Decomposition and its field arena; U, V live in register reg, NextU, NextV in nextReg,
+    /// the ADI intermediate or the second SSP-RK3 stage in wReg
+    /// cs doubles per cell: 1 for split U, V fields, 2 for interleaved (U,V) cells
+    D decomp;
+    int ld;
+    int cs;
+    int reg;
+    int nextReg;
+    int wReg;
+
+    /// ADI line operators along x and y
+    typename D::Line* lineX;
+    typename D::Line* lineY;
+    double factoredDt;
+
+    /// Backward Euler and Crank-Nicolson: linear solver on the work registers after nextReg
+    ImplicitSolver<D>* solver;
+    int solverIterations;
+    bool solverWarned;
+
+    /// Refined patches over the coarse fields (--amr), advanced after every Euler step
+    PatchHierarchy<D>* hierarchy;
+
+    /// Low-storage 2N Runge-Kutta coefficients (A_0 = 0): Williamson's three-stage third-order
+    /// scheme and Carpenter & Kennedy's five-stage fourth-order scheme
+    static constexpr double LSRK3_A[3] = {0.0, -5.0/9.0, -153.0/128.0};
+    static constexpr double LSRK3_B[3] = {1.0/3.0, 15.0/16.0, 8.0/15.0};
+    static constexpr double LSRK4_A[5] = {0.0, -567301805773.0/1357537059087.0,
+                                          -2404267990393.0/2016746695238.0,
+                                          -3550918686646.0/2091501179385.0,
+                                          -1275806237668.0/842570457699.0};
+    static constexpr double LSRK4_B[5] = {1432997174477.0/9575080441755.0,
+                                          5161836677717.0/13612068292357.0,
+                                          1720146321549.0/2090206949498.0,
+                                          3134564353537.0/4481467310338.0,
+                                          2277821191437.0/14882151754819.0};
+};
+
+/**
+ * @brief Public Constructor: Accepts a Model instance reference as input
+ * Allocates memory to all other instance variables
+ * @param &m reference to Model instance
+ * */
+template <class D>
+BurgersCore<D>::BurgersCore(Model &m) : model(&m), decomp(m, Registers(m)) {
+    bool adi = model->GetScheme() == Scheme::ADI;
+    bool implicit = model->IsImplicit();
+    cs = decomp.GetCellSize();
+    reg = 0;
+    nextReg = 1;
+    wReg = 2;
+    SetFields();
+
+    /// ADI line operators along x (rows) and y (columns), factored once dt is known
+    lineX = adi ? decomp.NewLineX() : nullptr;
+    lineY = adi ? decomp.NewLineY() : nullptr;
+    factoredDt = 0.0;
+
+    solver = implicit ? new ImplicitSolver<D>(m, &decomp, 2) : nullptr;
+    solverIterations = 0;
+    solverWarned = false;
+    hierarchy = model->IsRefined() ? new PatchHierarchy<D>(m, &decomp) : nullptr;
+    steps = 0;
+    t = 0.0;
+    started = false;
+    finished = false;
+}
+
+/**
+ * @brief Destructor: Deletes all allocated pointers in the class instance
+ * */
+template <class D>
+BurgersCore<D>::~BurgersCore() {
+    /// The decomposition frees the fields
+    delete lineX;
+    delete lineY;
+    delete solver;
+    delete hierarchy;
+
+    /// model is not dynamically alloc
+}
+
+/**
+ * @brief (U,V) registers of the arena: two, three for ADI and SSP-RK3, and the solver's work
+ * registers on top for the implicit schemes; ghost frames hold the boundary or the halos
+ * */
+template <class D>
+int BurgersCore<D>::Registers(const Model &m) {
+    if (m.IsImplicit()) return 2 + ImplicitSolver<D>::REGISTERS;
+    return (m.GetScheme() == Scheme::ADI || m.GetScheme() == Scheme::SSPRK3) ? 3 : 2;
+}
+
+/**
+ * @brief Points U, V and NextU, NextV at registers reg and nextReg of the current arena
+ * */
+template <class D>
+void BurgersCore<D>::SetFields() {
+    ld = decomp.GetStorage()->GetLd();
+    U = decomp.GetU(reg);
+    V = decomp.GetV(reg);
+    NextU = decomp.GetU(nextReg);
+    NextV = decomp.GetV(nextReg);
+}
+
+/**
+ * @brief Returns to the state after construction, keeping the allocations: zero fields, no
+ * solver history, ADI lines refactored on the next step. For another run after the Model's
+ * parameters changed (see Model::SetPhysics)
+ * */
+template <class D>
+void BurgersCore<D>::Reset() {
+    decomp.GetStorage()->Clear();
+    if (solver) solver->Reset();
+    if (hierarchy) hierarchy->Reset();
+    factoredDt = 0.0;
+    solverIterations = 0;
+    solverWarned = false;
+    steps = 0;
+    t = 0.0;
+    started = false;
+    finished = false;
+}
+
+/**
+ * @brief Sets initial velocity field in x,y for U0 (V0 = U0) from the selected profile
+ * */
+template <class D>
+void BurgersCore<D>::SetInitialVelocity() {
+    started = false;
+    switch (model->GetProfile()) {
+        case Profile::Gaussian:
+            SetProfile(GaussianProfile());
+            break;
+        default:
+            SetProfile(BumpProfile());
+            break;
+    }
+}
+
+/**
+ * @brief Fills the local U, V with a profile for the current cell size
+ * Coordinates are taken from global indices so they do not depend on the decomposition
+ * */
+template <class D>
+template <class P>
+void BurgersCore<D>::SetProfile(const P &p) {
+    int Nyr = decomp.GetNyr();
+    int Nxr = decomp.GetNxr();
+    double x0 = model->GetX0();
+    double y0 = model->GetY0();
+    double dx = model->GetDx();
+    double dy = model->GetDy();
+    int displ_x = decomp.GetDisplX();
+    int displ_y = decomp.GetDisplY();
+
+    if (model->IsStretched()) {
+        const double* xs = model->GetMetricX().GetCoord() + displ_x;
+        const double* ys = model->GetMetricY().GetCoord() + displ_y;
+        if (cs == 2) FillProfile<2>(p, U, V, ld, Nxr, Nyr, xs, ys);
+        else FillProfile<1>(p, U, V, ld, Nxr, Nyr, xs, ys);
+        return;
+    }
+    if (cs == 2) FillProfile<2>(p, U, V, ld, Nxr, Nyr, x0, y0, dx, dy, displ_x, displ_y);
+    else FillProfile<1>(p, U, V, ld, Nxr, Nyr, x0, y0, dx, dy, displ_x, displ_y);
+}
+
+/**
+ * @brief Sets velocity field in x,y for U, V: integrates from the initial velocity up to T
+ * */
+template <class D>
+void BurgersCore<D>::SetIntegratedVelocity() {
+    Step(std::numeric_limits<int>::max());
+}
+
+/**
+ * @brief Advances U, V by up to n time steps, stopping at T; the first call after
+ * SetInitialVelocity() starts the integration
+ * Fixed time step: Nt-1 steps of dt in all. Adaptive time step: each step takes the CFL limit
+ * of the current fields, the last one ends on T. The explicit sweep tracks the local max |U|, |V|
+ * of the fields it writes, reduced for the following step
+ * @param n largest number of steps to take
+ * @return number of steps taken (0 once finished)
+ * */
+template <class D>
+int BurgersCore<D>::Step(int n) {
+    double T = model->GetT();
+    int rebalance = decomp.GetRebalanceInterval();
+
+    if (!started) BeginIntegration();
+
+    int taken = 0;
+    while (taken < n && !finished) {
+        double dt = model->GetDt();
+        if (model->IsAdaptive()) {
+            dt = model->StableTimeStep(maxU, maxV);
+            /* Stretch the step onto T rather than leave a sliver from rounding in t */
+            if (t + dt*(1.0 + 1e-9) >= T) {
+                dt = T - t;
+                finished = true;
+            }
+            model->SetTimeStep(dt);
+            Advance<true>();
+            ReduceMaxVelocities();
+        }
+        else {
+            if (hierarchy) AdvanceRefined();
+            else Advance<false>();
+            finished = (steps + 1 >= model->GetNt() - 1);
+        }
+        t += dt;
+        steps++;
+        taken++;
+        if (rebalance > 0 && steps % rebalance == 0 && !finished) Rebalance();
+    }
+    return taken;
+}
+
+/**
+ * @brief Starts the integration from the current fields at t = 0
+ * */
+template <class D>
+void BurgersCore<D>::BeginIntegration() {
+    SetActiveRegion();
+    steps = 0;
+    t = 0.0;
+    if (model->IsAdaptive()) {
+        SetMaxVelocities();
+        ReduceMaxVelocities();
+        finished = (model->GetT() <= 0.0);
+    }
+    else finished = (model->GetNt() - 1 <= 0);
+    if (hierarchy) {
+        SetMaxVelocities();
+        ReduceMaxVelocities();
+        hierarchy->Begin(maxU, maxV);
+    }
+    started = true;
+}
+
+/**
+ * @brief Advances U, V by one time step and swaps them with NextU, NextV
+ * @tparam TRACK also update the local maxU, maxV from the new fields
+ * */
+template <class D>
+template <bool TRACK>
+void BurgersCore<D>::Advance() {
+    /// Runge-Kutta schemes leave the new fields in U, V
+    switch (model->GetScheme()) {
+        case Scheme::SSPRK2:
+        case Scheme::SSPRK3:
+            StepSSP<TRACK>();
+            return;
+        case Scheme::LSRK3:
+        case Scheme::LSRK4:
+            StepLowStorage();
+            if (TRACK) SetMaxVelocities();
+            return;
+        default:
+            break;
+    }
+
+    Stage euler = {U, V, nullptr, nullptr, NextU, NextV, 0.0, 1.0, 1.0};
+    bool adi = model->GetScheme() == Scheme::ADI;
+    if (model->IsImplicit()) {
+        StepImplicit();
+    }
+    else if (adi) {
+        /// Explicit advection, then implicit diffusion; the max is taken once both are done
+        Sweep<false, EULER>(euler, reg);
+        DiffuseImplicit();
+    }
+    else {
+        Sweep<TRACK, EULER>(euler, reg);
+    }
+
+    std::swap(U, NextU);
+    std::swap(V, NextV);
+    std::swap(reg, nextReg);
+
+    if (TRACK && (adi || model->IsImplicit())) SetMaxVelocities();
+}
+
+/**
+ * @brief Euler step of the coarse fields, then of the refined patches over it, regridded every
+ * PatchHierarchy::REGRID steps within the active region, which grows to cover them
+ * */
+template <class D>
+void BurgersCore<D>::AdvanceRefined() {
+    if (steps % PatchHierarchy<D>::REGRID == 0) {
+        int box[4] = {activeX0, activeY0, activeX1, activeY1};
+        hierarchy->Regrid(reg, box);
+        activeX0 = box[0];
+        activeY0 = box[1];
+        activeX1 = box[2];
+        activeY1 = box[3];
+    }
+    Advance<false>();
+    hierarchy->Advance(nextReg, reg);
+}
+
+/**
+ * @brief SSP-RK2/RK3 step in Shu-Osher form, every stage blending U with an Euler step E(X) = X + dt L(X):
+ * RK2: U1 = E(U), U = 1/2 U + 1/2 E(U1)
+ * RK3: U1 = E(U), U2 = 3/4 U + 1/4 E(U1), U = 1/3 U + 2/3 E(U2)
+ * U1 goes to Next, U2 to W; the last stage overwrites U, which it only reads at the written cell.
+ * Each stage exchanges the halo of its input, so U is not written while neighbours may read it
+ * @tparam TRACK also update the local maxU, maxV from the new fields
+ * */
+template <class D>
+template <bool TRACK>
+void BurgersCore<D>::StepSSP() {
+    Sweep<false, EULER>({U, V, nullptr, nullptr, NextU, NextV, 0.0, 1.0, 1.0}, reg);
+    if (model->GetScheme() == Scheme::SSPRK2) {
+        Sweep<TRACK, ACCUMULATE>({NextU, NextV, U, V, U, V, 0.5, 0.5, 0.5}, nextReg);
+        return;
+    }
+    double* WU = decomp.GetU(wReg);
+    double* WV = decomp.GetV(wReg);
+    Sweep<false, BLEND>({NextU, NextV, U, V, WU, WV, 0.75, 0.25, 0.25}, nextReg);
+    Sweep<TRACK, ACCUMULATE>({WU, WV, U, V, U, V, 1.0/3.0, 2.0/3.0, 2.0/3.0}, wReg);
+}
+
+/**
+ * @brief Low-storage Runge-Kutta step in Williamson's 2N form, the increment dU held in Next:
+ * dU = A_k dU + dt L(U), then U = U + B_k dU, for every stage k
+ * The update runs over whole columns, ghosts and padding included: the ghosts of dU stay zero,
+ * and those of U are refreshed by the next exchange
+ * */
+template <class D>
+void BurgersCore<D>::StepLowStorage() {
+    int Nxr = decomp.GetNxr();
+
+    bool rk4 = model->GetScheme() == Scheme::LSRK4;
+    int stages = rk4 ? 5 : 3;
+    const double* A = rk4 ? LSRK4_A : LSRK3_A;
+    const double* B = rk4 ? LSRK4_B : LSRK3_B;
+
+    /// Interleaved: one span covers both components
+    int span = cs*Nxr*ld;
+    for (int k = 0; k < stages; k++) {
+        Sweep<false, ACCUMULATE>({U, V, NextU, NextV, NextU, NextV, A[k], 0.0, 1.0}, reg);
+        /* U is updated in place: neighbours must be done reading its edges */
+        decomp.Release();
+        F77NAME(daxpy)(span, B[k], NextU, 1, U, 1);
+        if (cs == 1) F77NAME(daxpy)(span, B[k], NextV, 1, V, 1);
+    }
+}
+
+/**
+ * @brief Linearly implicit step into NextU, NextV: (I - theta L_w) Next = (I + (1 - theta) L_w) U,
+ * theta = 1 is backward Euler, theta = 1/2 Crank-Nicolson (see ImplicitSolver for w)
+ * */
+template <class D>
+void BurgersCore<D>::StepImplicit() {
+    solverIterations += solver->Solve(reg, nextReg);
+    if (!solver->IsConverged() && !solverWarned) {
+        if (decomp.IsRoot()) std::cout << "WARN: Implicit solve did not converge" << std::endl;
+        solverWarned = true;
+    }
+}
+
+/**
+ * @brief Runs one explicit stage over the local domain for the current stencil, grid and cell size
+ * @tparam TRACK also update the local maxU, maxV from the written fields
+ * @tparam MODE stage update, see StageMode
+ * @param r register holding the stage input, whose halo is exchanged
+ * */
+template <class D>
+template <bool TRACK, typename BurgersCore<D>::StageMode MODE>
+void BurgersCore<D>::Sweep(const Stage &s, int r) {
+    GrowActiveRegion();
+    if (model->GetStencil() == Stencil::Central4) {
+        if (cs == 2) SweepNextVelocities<2, 2, false, TRACK, MODE>(s, r);
+        else SweepNextVelocities<1, 2, false, TRACK, MODE>(s, r);
+    }
+    else if (model->IsStretched()) {
+        if (cs == 2) SweepNextVelocities<2, 1, true, TRACK, MODE>(s, r);
+        else SweepNextVelocities<1, 1, true, TRACK, MODE>(s, r);
+    }
+    else {
+        if (cs == 2) SweepNextVelocities<2, 1, false, TRACK, MODE>(s, r);
+        else SweepNextVelocities<1, 1, false, TRACK, MODE>(s, r);
+    }
+}
+
+/**
+ * @brief Peaceman-Rachford ADI step of the diffusion of NextU, NextV over dt:
+ * (I - rx Dxx) W = (I + ry Dyy) Next, then (I - ry Dyy) Next = (I + rx Dxx) W.
+ * The explicit half-steps read the halos of Next and W, the solves span the whole grid lines
+ * */
+template <class D>
+void BurgersCore<D>::DiffuseImplicit() {
+    int Nyr = decomp.GetNyr();
+    int Nxr = decomp.GetNxr();
+
+    if (model->GetDt() != factoredDt) {
+        lineX->Factor(model->GetRx());
+        lineY->Factor(model->GetRy());
+        factoredDt = model->GetDt();
+    }
+
+    /// Lines along y are columns (contiguous cells), lines along x are rows (cells ld apart)
+    double* next[2] = {NextU, NextV};
+    double* w[2] = {decomp.GetU(wReg), decomp.GetV(wReg)};
+    decomp.Start(nextReg);
+    decomp.Finish();
+    for (int c = 0; c < 2; c++) {
+        lineY->Apply(next[c], w[c], cs, Nxr, cs*ld);
+        lineX->Solve(w[c], cs*ld, Nyr, cs);
+    }
+    decomp.Start(wReg);
+    decomp.Finish();
+    for (int c = 0; c < 2; c++) {
+        lineX->Apply(w[c], next[c], cs*ld, Nyr, cs);
+        lineY->Solve(next[c], cs, Nxr, cs*ld);
+    }
+}
+
+/**
+ * @brief Sets maxU, maxV to the largest |U|, |V| of the current local fields
+ * */
+template <class D>
+void BurgersCore<D>::SetMaxVelocities() {
+    int Nyr = decomp.GetNyr();
+    int Nxr = decomp.GetNxr();
+
+    maxU = 0.0;
+    maxV = 0.0;
+    for (int i = 0; i < Nxr; i++) {
+        for (int j = 0; j < Nyr; j++) {
+            maxU = std::max(maxU, std::fabs(U[cs*(i*ld+j)]));
+            maxV = std::max(maxV, std::fabs(V[cs*(i*ld+j)]));
+        }
+    }
+}
+
+/**
+ * @brief Replaces the local maxU, maxV by their maxima over the decomposition
+ * */
+template <class D>
+void BurgersCore<D>::ReduceMaxVelocities() {
+    double maxVel[2] = {maxU, maxV};
+    decomp.MaxAll(maxVel, 2);
+    maxU = maxVel[0];
+    maxV = maxVel[1];
+}
+
+/**
+ * @brief Sets the active region to the bounding box of the non-zero cells of U, V over the
+ * whole grid. ADI and the implicit schemes solve along whole lines or over the whole grid,
+ * and a periodic region wraps around the edges, so their region is the whole domain from the
+ * first step on
+ * */
+template <class D>
+void BurgersCore<D>::SetActiveRegion() {
+    int Nyr = decomp.GetNyr();
+    int Nxr = decomp.GetNxr();
+    int displ_x = decomp.GetDisplX();
+    int displ_y = decomp.GetDisplY();
+
+    if (model->GetScheme() == Scheme::ADI || model->IsImplicit() || model->IsPeriodic()) {
+        activeX0 = 0;
+        activeX1 = model->GetNx() - 2;
+        activeY0 = 0;
+        activeY1 = model->GetNy() - 2;
+        return;
+    }
+
+    /// Local box in global indices; the upper bounds are negated so one minimum reduces all four
+    int box[4] = {model->GetNx() - 2, model->GetNy() - 2, 0, 0};
+    for (int i = 0; i < Nxr; i++) {
+        for (int j = 0; j < Nyr; j++) {
+            if (U[cs*(i*ld+j)] != 0.0 || V[cs*(i*ld+j)] != 0.0) {
+                box[0] = std::min(box[0], displ_x + i);
+                box[1] = std::min(box[1], displ_y + j);
+                box[2] = std::min(box[2], -(displ_x + i + 1));
+                box[3] = std::min(box[3], -(displ_y + j + 1));
+            }
+        }
+    }
+    decomp.MinAll(box, 4);
+    activeX0 = box[0];
+    activeY0 = box[1];
+    activeX1 = -box[2];
+    activeY1 = -box[3];
+
+    /* All-zero fields stay zero: keep an empty region */
+    if (activeX0 >= activeX1) {
+        activeX0 = activeX1 = activeY0 = activeY1 = 0;
+    }
+}
+
+/**
+ * @brief Widens the active region by the reach of the stencil on every side, within the domain
+ * Outside it, every input cell and its neighbours are zero, so a stage writes zero there
+ * */
+template <class D>
+void BurgersCore<D>::GrowActiveRegion() {
+    if (activeX0 >= activeX1) return;
+    int h = model->GetHaloWidth();
+    activeX0 = std::max(activeX0 - h, 0);
+    activeX1 = std::min(activeX1 + h, model->GetNx() - 2);
+    activeY0 = std::max(activeY0 - h, 0);
+    activeY1 = std::min(activeY1 + h, model->GetNy() - 2);
+}
+
+/**
+ * @brief Repartitions the grid by the measured compute time (see D::Repartition), which moves
+ * U, V to register 0 of a new arena. The other registers only hold stage temporaries and start
+ * from zero in the new arena, like the ghost frames
+ * */
+template <class D>
+void BurgersCore<D>::Rebalance() {
+    if (!decomp.Repartition(reg)) return;
+    reg = 0;
+    nextReg = 1;
+    SetFields();
+
+    /// ADI line operators are sized by the sub-matrix; refactored on the next step
+    if (lineX) {
+        delete lineX;
+        delete lineY;
+        lineX = decomp.NewLineX();
+        lineY = decomp.NewLineY();
+        factoredDt = 0.0;
+    }
+}
+
+/**
+ * @brief Writes the velocity field for U, V into a file
+ * IMPORTANT: Run SetIntegratedVelocity() first
+ * */
+template <class D>
+void BurgersCore<D>::WriteVelocityFile() {
+    decomp.WriteVelocityFile(U, V);
+}
+
+/**
+ * @brief Calculates and sets energy of velocity field
+ * On a stretched grid every cell is weighted by its area, the product of its control widths
+ * */
+template <class D>
+void BurgersCore<D>::SetEnergy() {
+    if (!model->IsStretched()) {
+        E = 0.5 * decomp.SumOfSquares(U, V) * model->GetDx()*model->GetDy();
+        return;
+    }
+    const double* wx = model->GetMetricX().GetWidth() + decomp.GetDisplX();
+    const double* wy = model->GetMetricY().GetWidth() + decomp.GetDisplY();
+    E = 0.5 * decomp.SumOfSquares(U, V, wx, wy);
+}
+
+/**
+ * @brief Computes the next velocity state for cells of CS doubles
+ * With halos to exchange, the interior is swept while they are in flight and the edge cells, H
+ * deep, once they have arrived; otherwise the domain is one block
+ * @tparam H reach of the stencil: 1 upwind, 2 fourth-order central
+ * @tparam STRETCHED take the upwind coefficients from the grid metrics
+ * @tparam TRACK reset the local maxU, maxV and let every sweep fold its cells into them
+ * @param s stage fields and coefficients
+ * @param r register holding the stage input
+ * */
+template <class D>
+template <int CS, int H, bool STRETCHED, bool TRACK, typename BurgersCore<D>::StageMode MODE>
+void BurgersCore<D>::SweepNextVelocities(const Stage &s, int r) {
+    int Nyr = decomp.GetNyr();
+    int Nxr = decomp.GetNxr();
+
+    if (TRACK) {
+        maxU = 0.0;
+        maxV = 0.0;
+    }
+
+    if (!D::OVERLAP) {
+        decomp.Start(r);
+        decomp.Finish();
+        decomp.BeginWork();
+        ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, 0, Nxr, 0, Nyr);
+        decomp.EndWork();
+        return;
+    }
+
+    /// The measured work leaves out the wait for the halos
+    decomp.Start(r);
+    decomp.BeginWork();
+    ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, H, Nxr-H, H, Nyr-H);
+    decomp.EndWork();
+    decomp.Finish();
+
+    /// Edge cells: first and last H columns, then first and last H rows between them
+    /* A sub-matrix narrower than 2H has overlapping edges: the bounds keep them disjoint */
+    decomp.BeginWork();
+    ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, 0, std::min(H, Nxr), 0, Nyr);
+    ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, std::max(H, Nxr-H), Nxr, 0, Nyr);
+    ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, H, Nxr-H, 0, std::min(H, Nyr));
+    ComputeNextVelocityState<CS, H, STRETCHED, TRACK, MODE>(s, H, Nxr-H, std::max(H, Nyr-H), Nyr);
+    decomp.EndWork();
+}
+
+/**
+ * @brief Computes linear and non-linear terms for U and V over columns [i0,i1) and rows [j0,j1)
+ * clipped to the active region; the cells outside it already hold the zero the stage would write.
+ * Neighbours outside the sub-matrix are read from the ghost frame (halo, periodic or zero boundary),
+ * so every cell is computed with the same order of operations whatever the decomposition.
+ * H = 1: first-order upwind advection, second-order central diffusion. The upwind side follows
+ * the sign of ax, ay (fixed for the run, in the Model constants) and of bU, bV (per cell).
+ * On a stretched grid the constants become those of column i and row j, and bU, bV are divided
+ * by the spacing on their upwind side.
+ * H = 2: fourth-order central differences, (-f[2] + 8f[1] - 8f[-1] + f[-2])/12h for the first
+ * derivative and (-f[2] + 16f[1] - 30f[0] + 16f[-1] - f[-2])/12h^2 for the second, along i and j
+ * @tparam CS doubles per cell: 1 for split U, V fields, 2 for interleaved (U,V) cells
+ * @tparam H reach of the stencil
+ * @tparam STRETCHED upwind stencil with per-column and per-row coefficients from the grid metrics
+ * @tparam TRACK fuse the max |out| reduction into the sweep
+ * @tparam MODE EULER: out = in + dt*L(in); BLEND, ACCUMULATE: out = a*acc + b*in + c*dt*L(in)
+ * @param s stage fields and coefficients
+ * */
+template <class D>
+template <int CS, int H, bool STRETCHED, bool TRACK, typename BurgersCore<D>::StageMode MODE>
+void BurgersCore<D>::ComputeNextVelocityState(const Stage &s, int i0, int i1, int j0, int j1) {
+    /// Local bounds of the active region
+    i0 = std::max(i0, activeX0 - decomp.GetDisplX());
+    i1 = std::min(i1, activeX1 - decomp.GetDisplX());
+    j0 = std::max(j0, activeY0 - decomp.GetDisplY());
+    j1 = std::min(j1, activeY1 - decomp.GetDisplY());
+
+    /// Compute first, second derivatives, & non-linear terms
+    double alpha_sum = model->GetAlpha_Sum();
+    double beta_dx_sum = model->GetBetaDx_Sum();
+    double beta_dy_sum = model->GetBetaDy_Sum();
+    double beta_dx_2 = model->GetBetaDx_2();
+    double beta_dy_2 = model->GetBetaDy_2();
+    double bdx = model->GetBDx();
+    double bdy = model->GetBDy();
+
+    /// Fourth-order central: advection (a + b u) dt/12dx, bu dt/12dx per unit u, diffusion c dt/12dx^2
+    double dt = model->GetDt();
+    double dx = model->GetDx();
+    double dy = model->GetDy();
+    double px0 = model->GetAx()*dt/(12.0*dx);
+    double py0 = model->GetAy()*dt/(12.0*dy);
+    double pbx = model->GetB()*dt/(12.0*dx);
+    double pby = model->GetB()*dt/(12.0*dy);
+    double qx = model->GetC()*dt/(12.0*dx*dx);
+    double qy = model->GetC()*dt/(12.0*dy*dy);
+    double q0 = -30.0*(qx + qy);
+
+    /// Stretched grid: row coefficients from local row 0, read as streams along the column
+    const GridMetric &mx = model->GetMetricX();
+    const GridMetric &my = model->GetMetricY();
+    int displ_x = decomp.GetDisplX();
+    int displ_y = STRETCHED ? decomp.GetDisplY() : 0;
+    const double* yc = my.GetCentre() + displ_y;
+    const double* yb = my.GetBack() + displ_y;
+    const double* yf = my.GetFwd() + displ_y;
+    const double* ybm = my.GetBMinus() + displ_y;
+    const double* ybp = my.GetBPlus() + displ_y;
+
+    double mu = 0.0;
+    double mv = 0.0;
+    const double* inU = s.inU;
+    const double* inV = s.inV;
+    double* outU = s.outU;
+    double* outV = s.outV;
+    const double* accU = (MODE == ACCUMULATE) ? outU : s.accU;
+    const double* accV = (MODE == ACCUMULATE) ? outV : s.accV;
+    double a = s.a;
+    double b = s.b;
+    double c = s.c;
+
+    for (int i = i0; i < i1; i++) {
+        int start = CS*i*ld;
+        /* Stretched grid: column coefficients, constant along the column */
+        double xc = 0.0, xb = 0.0, xf = 0.0, xbm = 0.0, xbp = 0.0;
+        if (STRETCHED) {
+            xc = mx.GetCentre()[displ_x + i];
+            xb = mx.GetBack()[displ_x + i];
+            xf = mx.GetFwd()[displ_x + i];
+            xbm = mx.GetBMinus()[displ_x + i];
+            xbp = mx.GetBPlus()[displ_x + i];
+        }
+        for (int j = j0; j < j1; j++) {
+            int curr = start + CS*j;
+            double nextU;
+            double nextV;
+            if (H == 2) {
+                double px = px0 + pbx * inU[curr];
+                double py = py0 + pby * inV[curr];
+                double cx1 = 16.0*qx - 8.0*px;
+                double cx_1 = 16.0*qx + 8.0*px;
+                double cx2 = px - qx;
+                double cx_2 = -px - qx;
+                double cy1 = 16.0*qy - 8.0*py;
+                double cy_1 = 16.0*qy + 8.0*py;
+                double cy2 = py - qy;
+                double cy_2 = -py - qy;
+                nextU = q0 * inU[curr];
+                nextV = q0 * inV[curr];
+                nextU += cx1 * inU[curr+CS*ld] + cx_1 * inU[curr-CS*ld];
+                nextV += cx1 * inV[curr+CS*ld] + cx_1 * inV[curr-CS*ld];
+                nextU += cx2 * inU[curr+2*CS*ld] + cx_2 * inU[curr-2*CS*ld];
+                nextV += cx2 * inV[curr+2*CS*ld] + cx_2 * inV[curr-2*CS*ld];
+                nextU += cy1 * inU[curr+CS] + cy_1 * inU[curr-CS];
+                nextV += cy1 * inV[curr+CS] + cy_1 * inV[curr-CS];
+                nextU += cy2 * inU[curr+2*CS] + cy_2 * inU[curr-2*CS];
+                nextV += cy2 * inV[curr+2*CS] + cy_2 * inV[curr-2*CS];
+            }
+            else if (STRETCHED) {
+                /* b U dt/h on the upwind side: hm for b U > 0 (neighbour behind), hp for b U < 0 */
+                double bxU_m = std::max(xbm * inU[curr], 0.0);
+                double bxU_p = std::min(xbp * inU[curr], 0.0);
+                double byV_m = std::max(ybm[j] * inV[curr], 0.0);
+                double byV_p = std::min(ybp[j] * inV[curr], 0.0);
+
+                double alpha_total = xc + yc[j] - bxU_m + bxU_p - byV_m + byV_p;
+                double back_x = xb + bxU_m;
+                double fwd_x = xf - bxU_p;
+                double back_y = yb[j] + byV_m;
+                double fwd_y = yf[j] - byV_p;
+                nextU = alpha_total * inU[curr];
+                nextV = alpha_total * inV[curr];
+                nextU += fwd_x * inU[curr+CS*ld];
+                nextV += fwd_x * inV[curr+CS*ld];
+                nextU += back_x * inU[curr-CS*ld];
+                nextV += back_x * inV[curr-CS*ld];
+                nextU += fwd_y * inU[curr+CS];
+                nextV += fwd_y * inV[curr+CS];
+                nextU += back_y * inU[curr-CS];
+                nextV += back_y * inV[curr-CS];
+            }
+            else {
+                double bdxU = bdx * inU[curr];
+                double bdyV = bdy * inV[curr];
+
+                /* Upwind side of b*U, b*V picked by sign with min/max, not a branch */
+                double alpha_total = alpha_sum - std::fabs(bdxU) - std::fabs(bdyV);
+                double bdxU_total = std::max(bdxU, 0.0) + beta_dx_sum;
+                double bdyV_total = std::max(bdyV, 0.0) + beta_dy_sum;
+                double fdxU_total = beta_dx_2 - std::min(bdxU, 0.0);
+                double fdyV_total = beta_dy_2 - std::min(bdyV, 0.0);
+                nextU = alpha_total * inU[curr];
+                nextV = alpha_total * inV[curr];
+                nextU += fdxU_total * inU[curr+CS*ld];
+                nextV += fdxU_total * inV[curr+CS*ld];
+                nextU += bdxU_total * inU[curr-CS*ld];
+                nextV += bdxU_total * inV[curr-CS*ld];
+                nextU += fdyV_total * inU[curr+CS];
+                nextV += fdyV_total * inV[curr+CS];
+                nextU += bdyV_total * inU[curr-CS];
+                nextV += bdyV_total * inV[curr-CS];
+            }
+            if (MODE != EULER) {
+                outU[curr] = a*accU[curr] + b*inU[curr] + c*nextU;
+                outV[curr] = a*accV[curr] + b*inV[curr] + c*nextV;
+            }
+            else {
+                outU[curr] = nextU + inU[curr];
+                outV[curr] = nextV + inV[curr];
+            }
+            if (TRACK) {
+                mu = std::max(mu, std::fabs(outU[curr]));
+                mv = std::max(mv, std::fabs(outV[curr]));
+            }
+        }
+    }
+    if (TRACK) {
+        maxU = std::max(maxU, mu);
+        maxV = std::max(maxV, mv);
+    }
+}
+#endif //CLASS_BURGERSCORE
@@ -0,0 +1,135 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+
+/**
+ * Ensemble mode, selected with --ensemble=FILE: many parameter sets run on one set of fields.
+ * The file holds one case "ax ay b c" per line; blank lines and lines starting with '#' are
+ * skipped. Each case resets the solver in place, so the fields are allocated once per solver,
+ * and the final energies go to one table, ensemble.txt
+ * */
+
+/// Parameters and results of one case
+struct EnsembleCase {
+    double ax, ay, b, c;
+    int steps;
+    double E;
+};
+
+/**
+ * @brief Reads the cases of an ensemble file
+ * @param file path of the ensemble file
+ * @param &cases set to a new[] array of the cases read (nullptr on failure)
+ * @return number of cases, or -1 if the file cannot be read or a line is malformed
+ * */
+inline int ReadEnsemble(const char* file, EnsembleCase* &cases) {
+    cases = nullptr;
+    std::ifstream in(file);
+    if (!in) return -1;
+
+    /// First pass counts the cases, the second fills them
+    std::string line;
+    int n = 0;
+    while (std::getline(in, line)) {
+        size_t k = line.find_first_not_of(" \t\r");
+        if (k != std::string::npos && line[k] != '#') ++n;
+    }
+
+    cases = new EnsembleCase[n];
+    in.clear();
+    in.seekg(0);
+    int i = 0;
+    while (i < n && std::getline(in, line)) {
+        size_t k = line.find_first_not_of(" \t\r");
+        if (k == std::string::npos || line[k] == '#') continue;
+        std::istringstream fields(line);
+        EnsembleCase &e = cases[i++];
+        if (!(fields >> e.ax >> e.ay >> e.b >> e.c)) {
+            delete[] cases;
+            cases = nullptr;
+            return -1;
+        }
+        e.steps = 0;
+        e.E = 0.0;
+    }
+    return n;
+}
+
+/**
+ * @brief Runs cases first, first + stride, ... on one solver, resetting it between cases
+ * A case with a negative diffusion c is not run; it reports NaN energy and no steps
+ * @param &burgers solver built on model, reused for every case
+ * @param &model model of the solver, whose physics are replaced case by case
+ * @param cases cases to run; steps and E are set on return
+ * @param n number of cases
+ * */
+template <class B, class M>
+void RunCases(B &burgers, M &model, EnsembleCase* cases, int n, int first, int stride) {
+    for (int i = first; i < n; i += stride) {
+        EnsembleCase &e = cases[i];
+        if (!model.SetPhysics(e.ax, e.ay, e.b, e.c)) {
+            e.steps = 0;
+            e.E = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        burgers.Reset();
+        burgers.SetInitialVelocity();
+        burgers.SetIntegratedVelocity();
+        burgers.SetEnergy();
+        e.steps = burgers.GetSteps();
+        e.E = burgers.GetE();
+    }
+}
+
+/**
+ * @brief Runs the cases in batches of B::LANES on one batched solver: batch m holds cases
+ * m*LANES, ..., and batches first, first + stride, ... are run here
+ * Lanes past the last case or with a negative diffusion c are left idle; such a case reports
+ * NaN energy and no steps
+ * @param &batch batched solver, which sets the physics of each case on its model (see BurgersBatch)
+ * @param cases cases to run; steps and E are set on return
+ * @param n number of cases
+ * */
+template <class B>
+void RunBatchedCases(B &batch, EnsembleCase* cases, int n, int first, int stride) {
+    const int W = B::LANES;
+    bool valid[W];
+    for (int i0 = first*W; i0 < n; i0 += stride*W) {
+        for (int k = 0; k < W; k++) {
+            const EnsembleCase* e = (i0 + k < n) ? &cases[i0 + k] : nullptr;
+            valid[k] = e && batch.SetCase(k, e->ax, e->ay, e->b, e->c);
+            if (!e) batch.ClearCase(k);
+        }
+        batch.SetInitialVelocity();
+        batch.SetIntegratedVelocity();
+        batch.SetEnergy();
+        for (int k = 0; k < W && i0 + k < n; k++) {
+            EnsembleCase &e = cases[i0 + k];
+            e.steps = valid[k] ? batch.GetSteps() : 0;
+            e.E = valid[k] ? batch.GetE(k) : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+}
+
+/**
+ * @brief Writes the results table, one row per case
+ * @param file path of the table
+ * */
+inline void WriteEnsemble(const char* file, const EnsembleCase* cases, int n) {
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    out << "# case ax ay b c steps energy" << std::endl;
+    out << std::setprecision(10);
+    for (int i = 0; i < n; ++i) {
+        const EnsembleCase &e = cases[i];
+        out << i << " " << e.ax << " " << e.ay << " " << e.b << " " << e.c << " "
+            << e.steps << " " << e.E << std::endl;
+    }
+    out.close();
+}
+
+#endif //ENSEMBLE_H
@@ -0,0 +1,106 @@
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include "FieldStorage.h"
+
+/// Alignment of the arena and of every interior column (in cells of one double: 64 bytes)
+static const int ALIGN = 8;
+/// Column strides to avoid (in doubles: 2 KiB)
+static const int ALIAS = 256;
+/// Huge page size used when huge pages are requested
+static const std::size_t HUGE_PAGE = 2 << 20;
+
+/**
+ * @brief Constructor: allocates and zeroes an aligned arena for nfields fields of Nyr x Nxr
+ * @param Nyr interior rows
+ * @param Nxr interior columns
+ * @param nfields number of fields
+ * @param cellSize doubles per cell
+ * @param halo width of the ghost frame, at most ALIGN
+ * @param hugePages back the arena with transparent huge pages (madvise) when large enough
+ * */
+FieldStorage::FieldStorage(int Nyr, int Nxr, int nfields, int cellSize, int halo, bool hugePages)
+    : Nyr(Nyr), Nxr(Nxr), cellSize(cellSize), halo(halo), ld(Stride(Nyr, cellSize, halo)), nfields(nfields),
+      owner(true) {
+    std::size_t bytes = Bytes(Nyr, Nxr, nfields, cellSize, halo);
+    std::size_t align = ALIGN*sizeof(double);
+    if (hugePages && bytes >= HUGE_PAGE) align = HUGE_PAGE;
+    bytes = (bytes + align-1) / align * align;
+
+    arena = static_cast<double*>(std::aligned_alloc(align, bytes));
+#ifdef MADV_HUGEPAGE
+    if (align == HUGE_PAGE) madvise(arena, bytes, MADV_HUGEPAGE);
+#endif
+    memset(arena, 0, bytes);
+}
+
+/**
+ * @brief Constructor: lays the fields out in memory supplied (and owned) by the caller
+ * memory must hold Bytes(Nyr, Nxr, nfields, cellSize, halo) bytes, 64-byte aligned, and is zeroed here
+ * */
+FieldStorage::FieldStorage(int Nyr, int Nxr, int nfields, int cellSize, int halo, double* memory)
+    : Nyr(Nyr), Nxr(Nxr), cellSize(cellSize), halo(halo), ld(Stride(Nyr, cellSize, halo)), nfields(nfields),
+      arena(memory), owner(false) {
+    memset(arena, 0, Bytes(Nyr, Nxr, nfields, cellSize, halo));
+}
+
+/**
+ * @brief Destructor: frees the arena if it was allocated here
+ * */
+FieldStorage::~FieldStorage() {
+    if (owner) std::free(arena);
+}
+
+/**
+ * @brief Zeroes every field, ghost frames and padding included
+ * */
+void FieldStorage::Clear() {
+    memset(arena, 0, Bytes(Nyr, Nxr, nfields, cellSize, halo));
+}
+
+/**
+ * @brief Fills the ghost frame of field f periodically: the up and down ghost rows repeat the
+ * last and first halo interior rows, the left and right ghost columns the last and first halo
+ * interior columns. The corners are left alone, the stencils never read them
+ * */
+void FieldStorage::Wrap(int f) {
+    double* F = Field(f);
+    int cld = cellSize*ld;
+    int h = cellSize*halo;
+    std::size_t rows = h*sizeof(double);
+    for (int i = 0; i < Nxr; i++) {
+        double* col = F + i*cld;
+        memcpy(col - h, col + cellSize*Nyr - h, rows);
+        memcpy(col + cellSize*Nyr, col, rows);
+    }
+    for (int g = 1; g <= halo; g++) {
+        memcpy(F - g*cld, F + (Nxr-g)*cld, Nyr*cellSize*sizeof(double));
+        memcpy(F + (Nxr+g-1)*cld, F + (g-1)*cld, Nyr*cellSize*sizeof(double));
+    }
+}
+
+/**
+ * @brief Column stride in cells for Nyr interior rows: leading pad ending in the up ghosts,
+ * interior, down ghosts
+ * */
+int FieldStorage::Stride(int Nyr, int cellSize, int halo) {
+    int ld = (ALIGN + Nyr + halo + ALIGN-1) / ALIGN * ALIGN;
+    if ((ld*cellSize) % ALIAS == 0) ld += ALIGN;
+    return ld;
+}
+
+/**
+ * @brief Offset (in doubles) from the arena base to interior cell (0,0) of field f
+ * Each field spans Nxr+2*halo columns: left ghost columns, interior columns, right ghost columns
+ * */
+std::size_t FieldStorage::FieldOffset(int Nyr, int Nxr, int f, int cellSize, int halo) {
+    std::size_t ld = Stride(Nyr, cellSize, halo);
+    return cellSize*(f*(Nxr+2*halo)*ld + halo*ld + ALIGN);
+}
+
+/**
+ * @brief Size of the arena in bytes
+ * */
+std::size_t FieldStorage::Bytes(int Nyr, int Nxr, int nfields, int cellSize, int halo) {
+    return static_cast<std::size_t>(nfields)*(Nxr+2*halo)*Stride(Nyr, cellSize, halo)*cellSize*sizeof(double);
+}
@@ -0,0 +1,45 @@
+#ifndef CLASS_FIELDSTORAGE
+#define CLASS_FIELDSTORAGE
+
+#include <cstddef>
+
+/**
+ * @class FieldStorage
+ * @brief Single 64-byte aligned arena holding a set of equally sized fields in column-major format
+ * Every field is surrounded by a ghost frame halo cells wide (zero boundary or halo values), as wide
+ * as the reach of the stencil. Columns are
+ * padded so each interior column starts on a 64-byte boundary and the column stride is never a
+ * multiple of 2 KiB, which would map neighbouring columns onto the same cache sets.
+ * A cell holds cellSize consecutive doubles (2 for interleaved (U,V) pairs)
+ * */
+class FieldStorage {
+public:
+    FieldStorage(int Nyr, int Nxr, int nfields, int cellSize, int halo, bool hugePages);
+    FieldStorage(int Nyr, int Nxr, int nfields, int cellSize, int halo, double* memory);
+    ~FieldStorage();
+
+    void Clear();
+    void Wrap(int f);
+
+    /// Pointer to interior cell (0,0) of field f; cell (i,j) starts at Field(f)[cellSize*(i*GetLd()+j)]
+    double* Field(int f) const { return arena + FieldOffset(Nyr, Nxr, f, cellSize, halo); }
+    double* GetArena() const { return arena; }
+    int GetLd() const { return ld; }
+    int GetCellSize() const { return cellSize; }
+    int GetHalo() const { return halo; }
+    int GetNFields() const { return nfields; }
+
+    static int Stride(int Nyr, int cellSize, int halo);
+    static std::size_t FieldOffset(int Nyr, int Nxr, int f, int cellSize, int halo);
+    static std::size_t Bytes(int Nyr, int Nxr, int nfields, int cellSize, int halo);
+private:
+    int Nyr;
+    int Nxr;
+    int cellSize;
+    int halo;
+    int ld;
+    int nfields;
+    double* arena;
+    bool owner;
+};
+#endif //CLASS_FIELDSTORAGE
@@ -0,0 +1,132 @@
+#ifndef GRIDMETRIC_H
+#define GRIDMETRIC_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+/**
+ * @class GridMetric
+ * @brief Node positions and upwind stencil coefficients along one axis of a stretched grid
+ * Nodes sit at first + dir*L*(1 + sinh(s xi)/sinh(s))/2 for xi evenly spaced in [-1,1]: spacing
+ * is finest at the centre of the domain, where the pulse starts, and grows by up to cosh(s)
+ * towards the walls. Interior point k (node k+1) has spacings hm behind and hp ahead. Every array
+ * has one entry per interior point, indexed globally, and all of them share one allocation, so
+ * the sweep reads the coefficients of its column as scalars and those of its rows as
+ * unit-stride streams
+ * */
+class GridMetric {
+public:
+    GridMetric() : n(0), hmin(0.0), block(nullptr) {}
+    GridMetric(const GridMetric &other);
+    GridMetric& operator=(const GridMetric &other);
+    ~GridMetric() { delete[] block; }
+
+    void Set(int N, double first, double L, double dir, double s);
+    void SetCoefficients(double a, double b, double c);
+    void Scale(double dt);
+
+    /// Position and control width (hm + hp)/2 of interior point k
+    const double* GetCoord() const { return block; }
+    const double* GetWidth() const { return block + n; }
+    /// dt-scaled coefficients: cell, neighbour behind, neighbour ahead (linear advection upwinded
+    /// by the sign of a, and diffusion), and b dt/hm, b dt/hp for the non-linear term
+    const double* GetCentre() const { return block + 9*n; }
+    const double* GetBack() const { return block + 10*n; }
+    const double* GetFwd() const { return block + 11*n; }
+    const double* GetBMinus() const { return block + 12*n; }
+    const double* GetBPlus() const { return block + 13*n; }
+    double GetMinSpacing() const { return hmin; }
+
+private:
+    int n;
+    double hmin;
+    /// coord, width, hm, hp, then the five coefficients per unit time and the same scaled by dt
+    double* block;
+};
+
+/**
+ * @brief Copy constructor: copies the arrays, so every copy of a Model owns its metrics
+ * */
+inline GridMetric::GridMetric(const GridMetric &other) : n(other.n), hmin(other.hmin), block(nullptr) {
+    if (other.block != nullptr) {
+        block = new double[14*n];
+        std::copy(other.block, other.block + 14*n, block);
+    }
+}
+
+/**
+ * @brief Copy assignment, see the copy constructor
+ * */
+inline GridMetric& GridMetric::operator=(const GridMetric &other) {
+    if (this != &other) {
+        GridMetric copy(other);
+        std::swap(n, copy.n);
+        std::swap(hmin, copy.hmin);
+        std::swap(block, copy.block);
+    }
+    return *this;
+}
+
+/**
+ * @brief Places N nodes (boundaries included) on [first, first + dir*L] with stretching s > 0
+ * */
+inline void GridMetric::Set(int N, double first, double L, double dir, double s) {
+    if (N - 2 != n) {
+        delete[] block;
+        n = N - 2;
+        block = new double[14*n];
+    }
+    double* coord = block;
+    double* width = block + n;
+    double* hm = block + 2*n;
+    double* hp = block + 3*n;
+    double sinhS = std::sinh(s);
+    double prev = first;
+    hmin = L;
+    for (int k = 1; k < N; k++) {
+        double xi = 2.0*k/(N-1) - 1.0;
+        double pos = first + dir*L*(1.0 + std::sinh(s*xi)/sinhS)/2.0;
+        double h = std::fabs(pos - prev);
+        hmin = std::min(hmin, h);
+        if (k < N-1) {
+            coord[k-1] = pos;
+            hm[k-1] = h;
+        }
+        if (k > 1) hp[k-2] = h;
+        prev = pos;
+    }
+    for (int k = 0; k < n; k++) width[k] = (hm[k] + hp[k])/2.0;
+}
+
+/**
+ * @brief Sets the coefficients per unit time for advection speed a + b u and diffusion c
+ * Diffusion is the three-point second difference 2c/(hm+hp) ((f+ - f)/hp - (f - f-)/hm)
+ * */
+inline void GridMetric::SetCoefficients(double a, double b, double c) {
+    const double* hm = block + 2*n;
+    const double* hp = block + 3*n;
+    double* centre = block + 4*n;
+    double* back = block + 5*n;
+    double* fwd = block + 6*n;
+    double* bminus = block + 7*n;
+    double* bplus = block + 8*n;
+    for (int k = 0; k < n; k++) {
+        double dm = 2.0*c/(hm[k]*(hm[k] + hp[k]));
+        double dp = 2.0*c/(hp[k]*(hm[k] + hp[k]));
+        back[k] = std::max(a, 0.0)/hm[k] + dm;
+        fwd[k] = std::max(-a, 0.0)/hp[k] + dp;
+        centre[k] = -std::max(a, 0.0)/hm[k] - std::max(-a, 0.0)/hp[k] - dm - dp;
+        bminus[k] = b/hm[k];
+        bplus[k] = b/hp[k];
+    }
+}
+
+/**
+ * @brief Scales the coefficients per unit time by the time step
+ * */
+inline void GridMetric::Scale(double dt) {
+    for (int k = 0; k < 5*n; k++) block[9*n + k] = dt*block[4*n + k];
+}
+
+#endif //GRIDMETRIC_H
@@ -0,0 +1,371 @@
+#ifndef CLASS_IMPLICITSOLVER
+#define CLASS_IMPLICITSOLVER
+
+#include <algorithm>
+#include <cmath>
+#include "BLAS_Wrapper.h"
+
+/**
+ * @class ImplicitSolver
+ * @brief Matrix-free BiCGSTAB with Jacobi preconditioning for the implicit steps
+ * (I - theta L_w) x = (I + (1 - theta) L_w) u, where L_w is the upwind advection-diffusion update
+ * of the explicit sweep (same coefficients from Model, dt included) with the advecting velocity
+ * frozen at w: u itself for backward Euler, u extrapolated to the half step for Crank-Nicolson.
+ * Vectors are (U,V) registers of the decomposition's field arena: register k is made of fields
+ * ncomp*k + c, so the operator reads its neighbours from the same ghost frames, exchanged the
+ * same way, as the explicit path. Dot products are reduced over the decomposition; with MPI these
+ * collectives also let the shared-memory backend overwrite exchanged registers
+ * @tparam D decomposition policy (see BurgersCore)
+ * */
+template <class D>
+class ImplicitSolver {
+public:
+    typedef typename D::ModelType Model;
+
+    /// Work registers used from firstRegister on: r, rhat, p, v, t, z, w and the previous u
+    static const int REGISTERS = 8;
+
+    ImplicitSolver(Model &m, D* decomp, int firstRegister);
+
+    int Solve(int u, int x);
+    void Reset() { prevDt = 0.0; }
+    bool IsConverged() const { return converged; }
+private:
+    int Iterate(int w, int x, double tol2);
+    void Apply(int w, int in, int out);
+    template <int CS> void ApplyStencil(int w, int in, int out);
+    template <int CS> void ApplyOperator(int w, int in, int out, int i0, int i1, int j0, int j1);
+    void Precondition(int w, int in, int out);
+    double Dot(int a, int b) const;
+    void Dots(int a, int b, int c, int d, double* ab, double* cd) const;
+    double LocalDot(int a, int b) const;
+    void Update(int y, double alpha, int x, double beta);
+    void Copy(int y, int x);
+
+    Model* model;
+    D* decomp;
+    int first;
+    bool converged;
+
+    /// Time step that produced the previous u (0 before the first Crank-Nicolson step)
+    double prevDt;
+
+    /// Relative residual ||b - Ax|| / ||b|| at which a solve stops, and its iteration limit
+    static constexpr double TOL = 1e-10;
+    static const int MAX_ITER = 500;
+};
+
+/**
+ * @brief Constructor: binds the solver to the work registers of the decomposition's arena
+ * @param &m reference to Model instance
+ * @param decomp decomposition, with REGISTERS registers free from firstRegister on
+ * @param firstRegister first work register
+ * */
+template <class D>
+ImplicitSolver<D>::ImplicitSolver(Model &m, D* decomp, int firstRegister)
+    : model(&m), decomp(decomp), first(firstRegister), converged(true), prevDt(0.0) {
+}
+
+/**
+ * @brief Advances u by one implicit step: solves (I - theta L_w) x = (I + (1 - theta) L_w) u
+ * with right-preconditioned BiCGSTAB, starting from x = u
+ * @param u register holding the current velocity
+ * @param x register receiving the new velocity
+ * @return iterations taken; IsConverged() tells whether the tolerance was reached
+ * */
+template <class D>
+int ImplicitSolver<D>::Solve(int u, int x) {
+    double theta = model->GetTheta();
+    double dt = model->GetDt();
+    int r = first;
+    int v = first + 3;
+    int w = first + 6;
+    int prev = first + 7;
+
+    /// Advecting velocity: u, or for Crank-Nicolson u extrapolated to the half step
+    if (theta < 1.0 && prevDt > 0.0) {
+        double k = 0.5*dt/prevDt;
+        Copy(w, u);
+        Update(w, -k, prev, 1.0 + k);
+    }
+    else w = u;
+
+    /// Initial residual b - A u = L_w u = (u - A u) / theta; ||b|| sets the tolerance
+    Apply(w, u, v);
+    Copy(r, u);
+    Update(r, -1.0/theta, v, 1.0/theta);
+    Copy(x, u);
+    Update(x, 1.0 - theta, r, 1.0);
+    double tol2 = TOL*TOL*Dot(x, x);
+    Copy(x, u);
+
+    int it = Iterate(w, x, tol2);
+
+    if (theta < 1.0) {
+        Copy(prev, u);
+        prevDt = dt;
+    }
+    return it;
+}
+
+/**
+ * @brief BiCGSTAB iterations on x from the residual in register r, until ||r||^2 <= tol2
+ * Dot products needed together share one reduction: (t,t) with (t,r), and at the end of an
+ * iteration (r,r) with the (rhat,r) of the next one
+ * @return iterations taken
+ * */
+template <class D>
+int ImplicitSolver<D>::Iterate(int w, int x, double tol2) {
+    int r = first;
+    int rhat = first + 1;
+    int p = first + 2;
+    int v = first + 3;
+    int t = first + 4;
+    int z = first + 5;
+
+    converged = true;
+    Copy(rhat, r);
+    double rr, rhoNew;
+    Dots(r, r, rhat, r, &rr, &rhoNew);
+    if (rr <= tol2) return 0;
+
+    double rho = 1.0;
+    double alpha = 1.0;
+    double omega = 1.0;
+    for (int it = 1; it <= MAX_ITER; it++) {
+        if (rhoNew == 0.0) break;
+        if (it == 1) Copy(p, r);
+        else {
+            /* p = r + beta (p - omega v) */
+            double beta = (rhoNew/rho) * (alpha/omega);
+            Update(p, -omega, v, 1.0);
+            Update(p, 1.0, r, beta);
+        }
+        rho = rhoNew;
+
+        /// Half step along the preconditioned search direction
+        Precondition(w, p, z);
+        Apply(w, z, v);
+        alpha = rho / Dot(rhat, v);
+        Update(x, alpha, z, 1.0);
+        Update(r, -alpha, v, 1.0);
+        rr = Dot(r, r);
+        if (rr <= tol2) return it;
+
+        /// Stabilising step minimising the residual
+        Precondition(w, r, z);
+        Apply(w, z, t);
+        double tt, tr;
+        Dots(t, t, t, r, &tt, &tr);
+        if (tt == 0.0) break;
+        omega = tr / tt;
+        Update(x, omega, z, 1.0);
+        Update(r, -omega, t, 1.0);
+        Dots(r, r, rhat, r, &rr, &rhoNew);
+        if (rr <= tol2) return it;
+        if (omega == 0.0) break;
+    }
+    converged = false;
+    return MAX_ITER;
+}
+
+/**
+ * @brief out = (I - theta L_w) in for the current cell size
+ * */
+template <class D>
+void ImplicitSolver<D>::Apply(int w, int in, int out) {
+    if (decomp->GetCellSize() == 2) ApplyStencil<2>(w, in, out);
+    else ApplyStencil<1>(w, in, out);
+}
+
+/**
+ * @brief out = (I - theta L_w) in over the local domain
+ * With halos to exchange, the interior is computed while the halo of in is in flight and the
+ * edge cells once it has arrived; otherwise the domain is one block
+ * @tparam CS doubles per cell: 1 for split U, V fields, 2 for interleaved (U,V) cells
+ * */
+template <class D>
+template <int CS>
+void ImplicitSolver<D>::ApplyStencil(int w, int in, int out) {
+    int Nyr = decomp->GetNyr();
+    int Nxr = decomp->GetNxr();
+
+    if (!D::OVERLAP) {
+        decomp->Start(in);
+        decomp->Finish();
+        ApplyOperator<CS>(w, in, out, 0, Nxr, 0, Nyr);
+        return;
+    }
+
+    decomp->Start(in);
+    ApplyOperator<CS>(w, in, out, 1, Nxr-1, 1, Nyr-1);
+    decomp->Finish();
+
+    /// Edge cells: first and last column, then first and last row between them
+    ApplyOperator<CS>(w, in, out, 0, 1, 0, Nyr);
+    ApplyOperator<CS>(w, in, out, Nxr-1, Nxr, 0, Nyr);
+    ApplyOperator<CS>(w, in, out, 1, Nxr-1, 0, 1);
+    ApplyOperator<CS>(w, in, out, 1, Nxr-1, Nyr-1, Nyr);
+}
+
+/**
+ * @brief out = (I - theta L_w) in over columns [i0,i1) and rows [j0,j1), the stencil of the
+ * explicit sweep with coefficients taken from w. Neighbours are read from the ghost frame
+ * @tparam CS doubles per cell: 1 for split U, V fields, 2 for interleaved (U,V) cells
+ * */
+template <class D>
+template <int CS>
+void ImplicitSolver<D>::ApplyOperator(int w, int in, int out, int i0, int i1, int j0, int j1) {
+    int ld = decomp->GetStorage()->GetLd();
+    double theta = model->GetTheta();
+    double alpha_sum = model->GetAlpha_Sum();
+    double beta_dx_sum = model->GetBetaDx_Sum();
+    double beta_dy_sum = model->GetBetaDy_Sum();
+    double beta_dx_2 = model->GetBetaDx_2();
+    double beta_dy_2 = model->GetBetaDy_2();
+    double bdx = model->GetBDx();
+    double bdy = model->GetBDy();
+    const double* wU = decomp->GetU(w);
+    const double* wV = decomp->GetV(w);
+    const double* inU = decomp->GetU(in);
+    const double* inV = decomp->GetV(in);
+    double* outU = decomp->GetU(out);
+    double* outV = decomp->GetV(out);
+
+    for (int i = i0; i < i1; i++) {
+        int start = CS*i*ld;
+        for (int j = j0; j < j1; j++) {
+            int curr = start + CS*j;
+            double bdxU = bdx * wU[curr];
+            double bdyV = bdy * wV[curr];
+
+            double alpha_total = alpha_sum - std::fabs(bdxU) - std::fabs(bdyV);
+            double bdxU_total = std::max(bdxU, 0.0) + beta_dx_sum;
+            double bdyV_total = std::max(bdyV, 0.0) + beta_dy_sum;
+            double fdxU_total = beta_dx_2 - std::min(bdxU, 0.0);
+            double fdyV_total = beta_dy_2 - std::min(bdyV, 0.0);
+            double lU = alpha_total * inU[curr];
+            double lV = alpha_total * inV[curr];
+            lU += fdxU_total * inU[curr+CS*ld];
+            lV += fdxU_total * inV[curr+CS*ld];
+            lU += bdxU_total * inU[curr-CS*ld];
+            lV += bdxU_total * inV[curr-CS*ld];
+            lU += fdyV_total * inU[curr+CS];
+            lV += fdyV_total * inV[curr+CS];
+            lU += bdyV_total * inU[curr-CS];
+            lV += bdyV_total * inV[curr-CS];
+            outU[curr] = inU[curr] - theta*lU;
+            outV[curr] = inV[curr] - theta*lV;
+        }
+    }
+}
+
+/**
+ * @brief Jacobi preconditioner: out = in / diag(I - theta L_w)
+ * */
+template <class D>
+void ImplicitSolver<D>::Precondition(int w, int in, int out) {
+    int Nyr = decomp->GetNyr();
+    int Nxr = decomp->GetNxr();
+    int ld = decomp->GetStorage()->GetLd();
+    int cs = decomp->GetCellSize();
+    double theta = model->GetTheta();
+    double alpha_sum = model->GetAlpha_Sum();
+    double bdx = model->GetBDx();
+    double bdy = model->GetBDy();
+    const double* wU = decomp->GetU(w);
+    const double* wV = decomp->GetV(w);
+    const double* inU = decomp->GetU(in);
+    const double* inV = decomp->GetV(in);
+    double* outU = decomp->GetU(out);
+    double* outV = decomp->GetV(out);
+
+    for (int i = 0; i < Nxr; i++) {
+        for (int j = 0; j < Nyr; j++) {
+            int curr = cs*(i*ld + j);
+            double diag = 1.0 - theta*(alpha_sum - std::fabs(bdx*wU[curr]) - std::fabs(bdy*wV[curr]));
+            outU[curr] = inU[curr] / diag;
+            outV[curr] = inV[curr] / diag;
+        }
+    }
+}
+
+/**
+ * @brief Global dot product of two registers over the interior cells
+ * */
+template <class D>
+double ImplicitSolver<D>::Dot(int a, int b) const {
+    double sum = LocalDot(a, b);
+    decomp->SumAll(&sum, 1);
+    return sum;
+}
+
+/**
+ * @brief Two global dot products, (a,b) and (c,d), in one reduction
+ * */
+template <class D>
+void ImplicitSolver<D>::Dots(int a, int b, int c, int d, double* ab, double* cd) const {
+    double sums[2] = {LocalDot(a, b), LocalDot(c, d)};
+    decomp->SumAll(sums, 2);
+    *ab = sums[0];
+    *cd = sums[1];
+}
+
+/**
+ * @brief Dot product over the local interior cells, one column at a time
+ * An interleaved column holds both components in its first cs*Nyr doubles
+ * */
+template <class D>
+double ImplicitSolver<D>::LocalDot(int a, int b) const {
+    auto* storage = decomp->GetStorage();
+    int Nyr = decomp->GetNyr();
+    int Nxr = decomp->GetNxr();
+    int ld = storage->GetLd();
+    int cs = decomp->GetCellSize();
+    int ncomp = 2 / cs;
+
+    double sum = 0.0;
+    for (int c = 0; c < ncomp; c++) {
+        const double* fa = storage->Field(ncomp*a + c);
+        const double* fb = storage->Field(ncomp*b + c);
+        for (int i = 0; i < Nxr; i++) {
+            sum += F77NAME(ddot)(cs*Nyr, fa + cs*i*ld, 1, fb + cs*i*ld, 1);
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief y = alpha x + beta y over whole columns
+ * The ghosts written here are either refreshed by the next exchange of y or never read:
+ * at the physical boundary they stay zero, since every register is built from zero-ghost ones
+ * */
+template <class D>
+void ImplicitSolver<D>::Update(int y, double alpha, int x, double beta) {
+    auto* storage = decomp->GetStorage();
+    int cs = decomp->GetCellSize();
+    int ncomp = 2 / cs;
+    int span = cs*decomp->GetNxr()*storage->GetLd();
+    for (int c = 0; c < ncomp; c++) {
+        const double* xs = storage->Field(ncomp*x + c);
+        double* ys = storage->Field(ncomp*y + c);
+        for (int n = 0; n < span; n++) {
+            ys[n] = alpha*xs[n] + beta*ys[n];
+        }
+    }
+}
+
+/**
+ * @brief y = x over whole columns
+ * */
+template <class D>
+void ImplicitSolver<D>::Copy(int y, int x) {
+    auto* storage = decomp->GetStorage();
+    int cs = decomp->GetCellSize();
+    int ncomp = 2 / cs;
+    int span = cs*decomp->GetNxr()*storage->GetLd();
+    for (int c = 0; c < ncomp; c++) {
+        F77NAME(dcopy)(span, storage->Field(ncomp*x + c), 1, storage->Field(ncomp*y + c), 1);
+    }
+}
+#endif //CLASS_IMPLICITSOLVER
@@ -0,0 +1,119 @@
+#ifndef INITIALCONDITION_H
+#define INITIALCONDITION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/**
+ * Initial velocity profiles U0 = V0 = f(x, y), selectable with --init=.
+ * A profile is a functor with an inline operator() and the box [XMIN,XMAX] x [YMIN,YMAX] outside
+ * which it vanishes, so FillProfile only visits the cells inside it. A new profile takes a functor
+ * here, a Profile value in Model and a case in BurgersCore::SetInitialVelocity
+ * */
+
+/// Compactly supported bump 2 (1 - r)^4 (4 r + 1) for r <= 1, zero outside the unit disk.
+/// Branch-free: (1 - r) is clamped at zero, so the cell loop vectorises
+struct BumpProfile {
+    static constexpr double XMIN = -1.0;
+    static constexpr double XMAX = 1.0;
+    static constexpr double YMIN = -1.0;
+    static constexpr double YMAX = 1.0;
+
+    double operator()(double x, double y) const {
+        double r = std::sqrt(x*x + y*y);
+        double s = std::max(1.0 - r, 0.0);
+        double s2 = s*s;
+        return 2.0*s2*s2*(4.0*r + 1.0);
+    }
+};
+
+/// Gaussian 2 exp(-4 r^2) of the same height, not compactly supported
+struct GaussianProfile {
+    static constexpr double XMIN = -std::numeric_limits<double>::infinity();
+    static constexpr double XMAX = std::numeric_limits<double>::infinity();
+    static constexpr double YMIN = -std::numeric_limits<double>::infinity();
+    static constexpr double YMAX = std::numeric_limits<double>::infinity();
+
+    double operator()(double x, double y) const {
+        return 2.0*std::exp(-4.0*(x*x + y*y));
+    }
+};
+
+/**
+ * @brief Sub-range [k0,k1) of the cells k in [0,n) whose coordinate first + k*h can lie in [lo,hi]
+ * One cell of margin on each side absorbs rounding; profiles vanish outside their box anyway
+ * */
+inline void ClipToBox(double lo, double hi, double first, double h, int n, int &k0, int &k1) {
+    k0 = 0;
+    k1 = n;
+    if (!(h > 0.0)) return;
+    double a = std::floor((lo - first)/h);
+    double b = std::ceil((hi - first)/h) + 1.0;
+    k0 = static_cast<int>(std::min(std::max(a, 0.0), static_cast<double>(n)));
+    k1 = static_cast<int>(std::min(std::max(b, 0.0), static_cast<double>(n)));
+    k1 = std::max(k1, k0);
+}
+
+/**
+ * @brief Evaluates a profile once per cell into U and copies it into V, inside the profile's box only
+ * Cells outside the box are left as they are (zero in freshly allocated fields).
+ * Column i and row j lie at x0 + (offX+i+1) dx, y0 - (offY+j+1) dy, so a cell gets the same value
+ * whatever the decomposition
+ * @tparam CS doubles per cell: 1 for split U, V fields, 2 for interleaved (U,V) cells
+ * @param p profile
+ * @param U, V interior cell (0,0) of the fields
+ * @param ld cells between consecutive columns
+ * @param Nxr, Nyr local columns and rows
+ * @param x0, y0 top left corner of the domain
+ * @param dx, dy grid spacing
+ * @param offX, offY global index of the local cell (0,0)
+ * */
+template <int CS, class P>
+void FillProfile(const P &p, double* U, double* V, int ld, int Nxr, int Nyr,
+                 double x0, double y0, double dx, double dy, int offX, int offY) {
+    int i0, i1, j0, j1;
+    ClipToBox(P::XMIN, P::XMAX, x0 + (offX+1)*dx, dx, Nxr, i0, i1);
+    ClipToBox(-P::YMAX, -P::YMIN, (offY+1)*dy - y0, dy, Nyr, j0, j1);
+
+    for (int i = i0; i < i1; i++) {
+        double x = x0 + (offX+i+1)*dx;
+        double* u = U + CS*i*ld;
+        for (int j = j0; j < j1; j++) {
+            double y = y0 - (offY+j+1)*dy;
+            double f = p(x, y);
+            u[CS*j] = f;
+            /* Interleaved cells: V is the second double, written through u so the loop has one stream */
+            if (CS == 2) u[CS*j + 1] = f;
+        }
+        /* Split fields: V is a copy of the U column */
+        if (CS == 1) std::memcpy(V + i*ld + j0, u + j0, (j1 - j0)*sizeof(double));
+    }
+}
+
+/**
+ * @brief FillProfile on a stretched grid: column i and row j lie at xs[i], ys[j], the node
+ * positions of the grid metrics offset to the local cell (0,0). xs increases and ys decreases,
+ * so the cells inside the profile's box are found by bisection
+ * */
+template <int CS, class P>
+void FillProfile(const P &p, double* U, double* V, int ld, int Nxr, int Nyr, const double* xs, const double* ys) {
+    int i0 = std::lower_bound(xs, xs + Nxr, P::XMIN) - xs;
+    int i1 = std::upper_bound(xs + i0, xs + Nxr, P::XMAX) - xs;
+    int j0 = std::lower_bound(ys, ys + Nyr, P::YMAX, [](double y, double v) { return y > v; }) - ys;
+    int j1 = std::upper_bound(ys + j0, ys + Nyr, P::YMIN, [](double v, double y) { return v > y; }) - ys;
+
+    for (int i = i0; i < i1; i++) {
+        double x = xs[i];
+        double* u = U + CS*i*ld;
+        for (int j = j0; j < j1; j++) {
+            double f = p(x, ys[j]);
+            u[CS*j] = f;
+            if (CS == 2) u[CS*j + 1] = f;
+        }
+        if (CS == 1) std::memcpy(V + i*ld + j0, u + j0, (j1 - j0)*sizeof(double));
+    }
+}
+
+#endif //INITIALCONDITION_H
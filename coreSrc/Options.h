@@ -0,0 +1,24 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+/// Field layouts selectable with --layout=: separate U and V arrays or interleaved (U,V) cells
+enum class Layout { Split, Interleaved };
+
+/// Initial velocity profiles selectable with --init=: compactly supported bump or Gaussian
+enum class Profile { Bump, Gaussian };
+
+/// Boundary conditions selectable with --bc=: zero Dirichlet walls, or periodic in x and y with
+/// a period of Lx, Ly, the ghost frames wrapping around (halos from the opposite edge)
+enum class Boundary { Dirichlet, Periodic };
+
+/// Spatial stencils selectable with --stencil=: first-order upwind advection with second-order
+/// central diffusion (reach 1), or fourth-order central differences for both (reach 2, so ghost
+/// frames and halos two cells wide)
+enum class Stencil { Upwind, Central4 };
+
+/// Time integrators selectable with --scheme=: explicit Euler, IMEX with ADI diffusion,
+/// SSP Runge-Kutta (rk2, rk3), low-storage 2N Runge-Kutta (lsrk3, lsrk4),
+/// or linearly implicit backward Euler (implicit) and Crank-Nicolson (cn)
+enum class Scheme { Euler, ADI, SSPRK2, SSPRK3, LSRK3, LSRK4, Implicit, CrankNicolson };
+
+#endif //OPTIONS_H
@@ -0,0 +1,592 @@
+#ifndef CLASS_PATCHHIERARCHY
+#define CLASS_PATCHHIERARCHY
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+/**
+ * @class PatchHierarchy
+ * @brief Block-structured refinement of the explicit upwind step: a second level, twice as fine
+ * along x and y, made of fixed-size patches over the tiles of PATCH x PATCH coarse cells that
+ * lie within BUFFER cells of a cell whose divided gradient of U or V exceeds the threshold
+ * (--amr=threshold). Tiles are numbered over the whole grid and flagged over the decomposition,
+ * so every rank refines its part of the same tiles: a patch is a tile clipped to the local
+ * sub-matrix. After every coarse step the fine level takes GetSubsteps() steps of the same
+ * stencil with the fine spacings and dt/GetSubsteps(), then its values replace those of the
+ * coarse cells it covers. Fine node 2k sits on coarse node k; the ghosts of a patch are read
+ *  - from the patch next to it on this rank,
+ *  - else from the patch across the edge of the sub-matrix, whose facing fine edges the halo
+ *    neighbours pass on every substep (D::ExchangeFaces),
+ *  - else from the coarse level, bilinear in space and linear in time between the fields before
+ *    and after the coarse step, with their ghost frames exchanged as for a sweep and their
+ *    corners filled (FillCorners),
+ * which gives every fine node the same value whatever the decomposition. Patches are regridded
+ * every REGRID coarse steps; the ones kept keep their fine values, new ones start from the
+ * coarse level
+ * @tparam D decomposition policy (see BurgersCore)
+ * */
+template <class D>
+class PatchHierarchy {
+public:
+    typedef typename D::ModelType Model;
+
+    /// Coarse cells along a patch side, coarse steps between regrids, and the margin in coarse
+    /// cells refined around a flagged cell
+    static const int PATCH = 16;
+    static const int REGRID = 8;
+    static const int BUFFER = 2;
+    static const int MAX_SUBSTEPS = 1024;
+
+    PatchHierarchy(Model &m, D* decomp);
+    ~PatchHierarchy();
+
+    void Begin(double maxU, double maxV);
+    void Regrid(int r, int* box);
+    void Advance(int old, int cur);
+    void Reset();
+    int GetPatches() const { return refined; }
+    int GetSubsteps() const { return substeps; }
+private:
+    /**
+     * @brief Fine fields of one patch over local coarse cells [i0,i1) x [j0,j1): F x F nodes
+     * (ghost frame included), column by column like the coarse fields, current and next
+     * */
+    struct Patch {
+        int i0;
+        int i1;
+        int j0;
+        int j1;
+        double* block;
+        double* u;
+        double* v;
+        double* nu;
+        double* nv;
+    };
+
+    /// Fine nodes along a patch column, ghosts included
+    static const int F = 2*PATCH + 2;
+
+    void FillCorners(const int* regs, int n);
+    void Flag(int gi, int gj);
+    void Allocate(Patch &p, int tx, int ty, const double* U, const double* V);
+    void Free(Patch &p);
+    double Coarse(const double* W, int fi, int fj) const;
+    void Ghost(int fi, int fj, double theta, const double* oldU, const double* oldV,
+               const double* U, const double* V, double* u, double* v) const;
+    void FillGhosts(Patch &p, double theta, const double* oldU, const double* oldV,
+                    const double* U, const double* V);
+    void PackFaces();
+    void Update(Patch &p);
+    void Restrict(const Patch &p, double* U, double* V) const;
+
+    Model* model;
+    D* decomp;
+
+    /// Coarse layout of the arena, and the local sub-matrix
+    int ld;
+    int cs;
+    int Nxr;
+    int Nyr;
+
+    /// Global tiles, flagged -1 for refinement, and those refined over the whole grid
+    int ntx;
+    int nty;
+    int* flags;
+    int refined;
+
+    /// Tiles meeting the local sub-matrix: [tx0,tx1) x [ty0,ty1), one Patch each (block nullptr
+    /// when not refined), and the slots of the refined ones
+    int tx0;
+    int tx1;
+    int ty0;
+    int ty1;
+    Patch* patches;
+    int* list;
+    int npatches;
+
+    /// Fine edges of the sub-matrix passed to (Send) and from (Recv) the neighbours (up, down,
+    /// left, right): U then V of every fine node along the edge, NaN where it is not refined
+    double* faceSend[4];
+    double* faceRecv[4];
+    int faceCount[4];
+
+    /// Ends of the up and down ghost rows of up to two registers, passed to (Send) and from
+    /// (Recv) the left and right neighbours
+    double cornerSend[2][8];
+    double cornerRecv[2][8];
+
+    /// Fine substeps per coarse step, and the upwind coefficients of a fine substep
+    int substeps;
+    double alpha;
+    double backX;
+    double fwdX;
+    double backY;
+    double fwdY;
+    double bdx;
+    double bdy;
+};
+
+/**
+ * @brief Constructor: lays the tiles over the grid and the local sub-matrix, no patch refined
+ * @param &m reference to Model instance
+ * @param decomp decomposition of the coarse level
+ * */
+template <class D>
+PatchHierarchy<D>::PatchHierarchy(Model &m, D* decomp) : model(&m), decomp(decomp) {
+    ld = decomp->GetStorage()->GetLd();
+    cs = decomp->GetCellSize();
+    Nxr = decomp->GetNxr();
+    Nyr = decomp->GetNyr();
+    int displ_x = decomp->GetDisplX();
+    int displ_y = decomp->GetDisplY();
+
+    ntx = (model->GetNx() - 2 + PATCH - 1) / PATCH;
+    nty = (model->GetNy() - 2 + PATCH - 1) / PATCH;
+    flags = new int[ntx*nty];
+    refined = 0;
+
+    tx0 = displ_x / PATCH;
+    tx1 = (displ_x + Nxr - 1) / PATCH + 1;
+    ty0 = displ_y / PATCH;
+    ty1 = (displ_y + Nyr - 1) / PATCH + 1;
+    int nlocal = (tx1 - tx0) * (ty1 - ty0);
+    patches = new Patch[nlocal];
+    for (int k = 0; k < nlocal; k++) patches[k].block = nullptr;
+    list = new int[nlocal];
+    npatches = 0;
+
+    /// Edges along x (up, down) hold 2 Nxr fine nodes, along y (left, right) 2 Nyr
+    for (int d = 0; d < 4; d++) {
+        faceCount[d] = 2 * 2*((d < 2) ? Nxr : Nyr);
+        faceSend[d] = new double[faceCount[d]];
+        faceRecv[d] = new double[faceCount[d]];
+        std::fill(faceSend[d], faceSend[d] + faceCount[d], std::numeric_limits<double>::quiet_NaN());
+        std::fill(faceRecv[d], faceRecv[d] + faceCount[d], std::numeric_limits<double>::quiet_NaN());
+    }
+    substeps = 2;
+}
+
+/**
+ * @brief Destructor: frees the patches, tiles and edge buffers
+ * */
+template <class D>
+PatchHierarchy<D>::~PatchHierarchy() {
+    Reset();
+    delete[] flags;
+    delete[] patches;
+    delete[] list;
+    for (int d = 0; d < 4; d++) {
+        delete[] faceSend[d];
+        delete[] faceRecv[d];
+    }
+}
+
+/**
+ * @brief Drops every patch, for another run (see BurgersCore::Reset)
+ * */
+template <class D>
+void PatchHierarchy<D>::Reset() {
+    int nlocal = (tx1 - tx0) * (ty1 - ty0);
+    for (int k = 0; k < nlocal; k++) Free(patches[k]);
+    refined = 0;
+    npatches = 0;
+}
+
+/**
+ * @brief Sets the fine substeps for the current dt and largest |U|, |V| over the domain:
+ * halving the spacing doubles the advection and quadruples the diffusion per unit time, so
+ * substeps start at 2 and double until the fine cell keeps a non-negative coefficient, the
+ * bound of the upwind stencil (the explicit scheme does not raise the largest |U|, |V|), or
+ * reach MAX_SUBSTEPS
+ * */
+template <class D>
+void PatchHierarchy<D>::Begin(double maxU, double maxV) {
+    double hx = model->GetDx() / 2.0;
+    double hy = model->GetDy() / 2.0;
+    double ax = model->GetAx();
+    double ay = model->GetAy();
+    double c = model->GetC();
+
+    for (substeps = 2; ; substeps *= 2) {
+        double dt = model->GetDt() / substeps;
+        alpha = -(std::fabs(ax)/hx + std::fabs(ay)/hy + 2.0*c/(hx*hx) + 2.0*c/(hy*hy)) * dt;
+        backX = (std::max(ax, 0.0)/hx + c/(hx*hx)) * dt;
+        fwdX = (std::max(-ax, 0.0)/hx + c/(hx*hx)) * dt;
+        backY = (std::max(ay, 0.0)/hy + c/(hy*hy)) * dt;
+        fwdY = (std::max(-ay, 0.0)/hy + c/(hy*hy)) * dt;
+        bdx = model->GetB() * dt/hx;
+        bdy = model->GetB() * dt/hy;
+        if (1.0 + alpha - std::fabs(bdx)*maxU - std::fabs(bdy)*maxV >= 0.0 || substeps >= MAX_SUBSTEPS) break;
+    }
+}
+
+/**
+ * @brief Flags the tiles to refine from register r and rebuilds the local patches: the kept
+ * ones keep their fine values, new ones are interpolated from the coarse level
+ * @param r register holding the current velocity
+ * @param box active region {x0, y0, x1, y1} in global interior indices (see BurgersCore), which
+ * bounds the cells to look at and is widened to cover the refined tiles
+ * */
+template <class D>
+void PatchHierarchy<D>::Regrid(int r, int* box) {
+    int displ_x = decomp->GetDisplX();
+    int displ_y = decomp->GetDisplY();
+    const double* U = decomp->GetU(r);
+    const double* V = decomp->GetV(r);
+    double rdx = 1.0 / (2.0*model->GetDx());
+    double rdy = 1.0 / (2.0*model->GetDy());
+    double threshold = model->GetAMRThreshold();
+
+    /// Central differences read the neighbours' edges, new patches also the corners
+    decomp->Start(r);
+    decomp->Finish();
+    FillCorners(&r, 1);
+    std::fill(flags, flags + ntx*nty, 0);
+    if (box[0] < box[2]) {
+        /* Cells next to the active region have non-zero neighbours too */
+        int i0 = std::max(box[0] - 1 - displ_x, 0);
+        int i1 = std::min(box[2] + 1 - displ_x, Nxr);
+        int j0 = std::max(box[1] - 1 - displ_y, 0);
+        int j1 = std::min(box[3] + 1 - displ_y, Nyr);
+        for (int i = i0; i < i1; i++) {
+            for (int j = j0; j < j1; j++) {
+                int curr = cs*(i*ld + j);
+                double gx = std::max(std::fabs(U[curr+cs*ld] - U[curr-cs*ld]),
+                                     std::fabs(V[curr+cs*ld] - V[curr-cs*ld])) * rdx;
+                double gy = std::max(std::fabs(U[curr+cs] - U[curr-cs]),
+                                     std::fabs(V[curr+cs] - V[curr-cs])) * rdy;
+                if (std::max(gx, gy) > threshold) Flag(displ_x + i, displ_y + j);
+            }
+        }
+    }
+    decomp->MinAll(flags, ntx*nty);
+
+    /// Bounding box of the refined tiles
+    int n = model->GetNx() - 2;
+    int m = model->GetNy() - 2;
+    int tiles[4] = {n, m, 0, 0};
+    refined = 0;
+    for (int tx = 0; tx < ntx; tx++) {
+        for (int ty = 0; ty < nty; ty++) {
+            if (flags[tx*nty + ty] == 0) continue;
+            refined++;
+            tiles[0] = std::min(tiles[0], tx*PATCH);
+            tiles[1] = std::min(tiles[1], ty*PATCH);
+            tiles[2] = std::max(tiles[2], std::min((tx+1)*PATCH, n));
+            tiles[3] = std::max(tiles[3], std::min((ty+1)*PATCH, m));
+        }
+    }
+    if (refined > 0) {
+        /* The fine level writes the coarse cells it covers: keep them in the active region */
+        bool empty = box[0] >= box[2];
+        box[0] = empty ? tiles[0] : std::min(box[0], tiles[0]);
+        box[1] = empty ? tiles[1] : std::min(box[1], tiles[1]);
+        box[2] = empty ? tiles[2] : std::max(box[2], tiles[2]);
+        box[3] = empty ? tiles[3] : std::max(box[3], tiles[3]);
+    }
+
+    /// Local patches; the edges no patch covers any more go back to NaN
+    npatches = 0;
+    for (int tx = tx0; tx < tx1; tx++) {
+        for (int ty = ty0; ty < ty1; ty++) {
+            int k = (tx - tx0)*(ty1 - ty0) + (ty - ty0);
+            if (flags[tx*nty + ty] == 0) {
+                Free(patches[k]);
+                continue;
+            }
+            if (patches[k].block == nullptr) Allocate(patches[k], tx, ty, U, V);
+            list[npatches++] = k;
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        std::fill(faceSend[d], faceSend[d] + faceCount[d], std::numeric_limits<double>::quiet_NaN());
+    }
+}
+
+/**
+ * @brief Fills the corners of the ghost frames of n registers, whose edges were exchanged: the
+ * halos leave them out, but interpolation at a corner of the sub-matrix reads them. The corner
+ * beyond the left (right) edge is the end of the left (right) neighbour's up or down ghost row.
+ * At a wall there is no neighbour, and the corner keeps its zero
+ * */
+template <class D>
+void PatchHierarchy<D>::FillCorners(const int* regs, int n) {
+    if (!D::OVERLAP) return;
+    double* send[4] = {nullptr, nullptr, cornerSend[0], cornerSend[1]};
+    double* recv[4] = {nullptr, nullptr, cornerRecv[0], cornerRecv[1]};
+    int count[4] = {0, 0, 4*n, 4*n};
+    int ends[2] = {0, Nxr - 1};
+    for (int s = 0; s < 2; s++) {
+        for (int k = 0; k < n; k++) {
+            const double* W[2] = {decomp->GetU(regs[k]), decomp->GetV(regs[k])};
+            for (int c = 0; c < 2; c++) {
+                cornerSend[s][4*k + 2*c] = W[c][cs*(ends[s]*ld - 1)];
+                cornerSend[s][4*k + 2*c + 1] = W[c][cs*(ends[s]*ld + Nyr)];
+            }
+        }
+        std::fill(cornerRecv[s], cornerRecv[s] + 4*n, std::numeric_limits<double>::quiet_NaN());
+    }
+    decomp->ExchangeFaces(send, recv, count);
+
+    int ghosts[2] = {-1, Nxr};
+    for (int s = 0; s < 2; s++) {
+        if (std::isnan(cornerRecv[s][0])) continue;
+        for (int k = 0; k < n; k++) {
+            double* W[2] = {decomp->GetU(regs[k]), decomp->GetV(regs[k])};
+            for (int c = 0; c < 2; c++) {
+                W[c][cs*(ghosts[s]*ld - 1)] = cornerRecv[s][4*k + 2*c];
+                W[c][cs*(ghosts[s]*ld + Nyr)] = cornerRecv[s][4*k + 2*c + 1];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Flags the tiles within BUFFER cells of global interior cell (gi, gj)
+ * */
+template <class D>
+void PatchHierarchy<D>::Flag(int gi, int gj) {
+    int txa = std::max(gi - BUFFER, 0) / PATCH;
+    int txb = std::min(gi + BUFFER, model->GetNx() - 3) / PATCH;
+    int tya = std::max(gj - BUFFER, 0) / PATCH;
+    int tyb = std::min(gj + BUFFER, model->GetNy() - 3) / PATCH;
+    for (int tx = txa; tx <= txb; tx++) {
+        for (int ty = tya; ty <= tyb; ty++) flags[tx*nty + ty] = -1;
+    }
+}
+
+/**
+ * @brief Allocates the patch of global tile (tx, ty) and interpolates it from U, V
+ * */
+template <class D>
+void PatchHierarchy<D>::Allocate(Patch &p, int tx, int ty, const double* U, const double* V) {
+    int displ_x = decomp->GetDisplX();
+    int displ_y = decomp->GetDisplY();
+    p.i0 = std::max(tx*PATCH - displ_x, 0);
+    p.i1 = std::min((tx+1)*PATCH - displ_x, Nxr);
+    p.j0 = std::max(ty*PATCH - displ_y, 0);
+    p.j1 = std::min((ty+1)*PATCH - displ_y, Nyr);
+    p.block = new double[4*F*F]();
+    p.u = p.block;
+    p.v = p.block + F*F;
+    p.nu = p.block + 2*F*F;
+    p.nv = p.block + 3*F*F;
+
+    int nx = 2*(p.i1 - p.i0);
+    int ny = 2*(p.j1 - p.j0);
+    for (int a = 0; a < nx; a++) {
+        for (int b = 0; b < ny; b++) {
+            p.u[(a+1)*F + b+1] = Coarse(U, 2*p.i0 + a, 2*p.j0 + b);
+            p.v[(a+1)*F + b+1] = Coarse(V, 2*p.i0 + a, 2*p.j0 + b);
+        }
+    }
+}
+
+/**
+ * @brief Frees the fine fields of a patch, if refined
+ * */
+template <class D>
+void PatchHierarchy<D>::Free(Patch &p) {
+    delete[] p.block;
+    p.block = nullptr;
+}
+
+/**
+ * @brief Bilinear interpolation of coarse field W at fine node (fi, fj) of the local sub-matrix,
+ * fi in [-1, 2 Nxr], fj in [-1, 2 Nyr]: an even index sits on a coarse node, an odd one halfway
+ * between two, the ghost frame included. Nodes on coarse nodes get their value unchanged
+ * */
+template <class D>
+double PatchHierarchy<D>::Coarse(const double* W, int fi, int fj) const {
+    /* floor(f/2) for f >= -2 */
+    int i = (fi + 2)/2 - 1;
+    int j = (fj + 2)/2 - 1;
+    const double* w = W + cs*(i*ld + j);
+    int di = (fi & 1) ? cs*ld : 0;
+    int dj = (fj & 1) ? cs : 0;
+    return 0.5*(0.5*(w[0] + w[di]) + 0.5*(w[dj] + w[di+dj]));
+}
+
+/**
+ * @brief Ghost value of fine node (fi, fj) of the local sub-matrix at fraction theta of the
+ * coarse step, see the class description
+ * */
+template <class D>
+void PatchHierarchy<D>::Ghost(int fi, int fj, double theta, const double* oldU, const double* oldV,
+                              const double* U, const double* V, double* u, double* v) const {
+    if (fi >= 0 && fi < 2*Nxr && fj >= 0 && fj < 2*Nyr) {
+        int displ_x = decomp->GetDisplX();
+        int displ_y = decomp->GetDisplY();
+        int tx = (displ_x + fi/2) / PATCH;
+        int ty = (displ_y + fj/2) / PATCH;
+        const Patch &q = patches[(tx - tx0)*(ty1 - ty0) + (ty - ty0)];
+        if (q.block != nullptr) {
+            int k = (fi - 2*q.i0 + 1)*F + fj - 2*q.j0 + 1;
+            *u = q.u[k];
+            *v = q.v[k];
+            return;
+        }
+    }
+    else {
+        /* No corners: the node is past exactly one edge */
+        int d = (fj < 0) ? 0 : (fj >= 2*Nyr) ? 1 : (fi < 0) ? 2 : 3;
+        int k = (d < 2) ? fi : fj;
+        double fu = faceRecv[d][k];
+        if (!std::isnan(fu)) {
+            *u = fu;
+            *v = faceRecv[d][faceCount[d]/2 + k];
+            return;
+        }
+    }
+    *u = (1.0 - theta)*Coarse(oldU, fi, fj) + theta*Coarse(U, fi, fj);
+    *v = (1.0 - theta)*Coarse(oldV, fi, fj) + theta*Coarse(V, fi, fj);
+}
+
+/**
+ * @brief Fills the ghost frame of a patch (corners aside, the stencil has none)
+ * */
+template <class D>
+void PatchHierarchy<D>::FillGhosts(Patch &p, double theta, const double* oldU, const double* oldV,
+                                   const double* U, const double* V) {
+    int fi0 = 2*p.i0;
+    int fj0 = 2*p.j0;
+    int nx = 2*(p.i1 - p.i0);
+    int ny = 2*(p.j1 - p.j0);
+    for (int b = 0; b < ny; b++) {
+        Ghost(fi0 - 1, fj0 + b, theta, oldU, oldV, U, V, &p.u[b+1], &p.v[b+1]);
+        Ghost(fi0 + nx, fj0 + b, theta, oldU, oldV, U, V, &p.u[(nx+1)*F + b+1], &p.v[(nx+1)*F + b+1]);
+    }
+    for (int a = 0; a < nx; a++) {
+        Ghost(fi0 + a, fj0 - 1, theta, oldU, oldV, U, V, &p.u[(a+1)*F], &p.v[(a+1)*F]);
+        Ghost(fi0 + a, fj0 + ny, theta, oldU, oldV, U, V, &p.u[(a+1)*F + ny+1], &p.v[(a+1)*F + ny+1]);
+    }
+}
+
+/**
+ * @brief Copies the fine nodes of the patches along the edges of the sub-matrix to faceSend
+ * */
+template <class D>
+void PatchHierarchy<D>::PackFaces() {
+    for (int k = 0; k < npatches; k++) {
+        const Patch &p = patches[list[k]];
+        int nx = 2*(p.i1 - p.i0);
+        int ny = 2*(p.j1 - p.j0);
+        if (p.j0 == 0 || p.j1 == Nyr) {
+            for (int a = 0; a < nx; a++) {
+                int f = 2*p.i0 + a;
+                if (p.j0 == 0) {
+                    faceSend[0][f] = p.u[(a+1)*F + 1];
+                    faceSend[0][faceCount[0]/2 + f] = p.v[(a+1)*F + 1];
+                }
+                if (p.j1 == Nyr) {
+                    faceSend[1][f] = p.u[(a+1)*F + ny];
+                    faceSend[1][faceCount[1]/2 + f] = p.v[(a+1)*F + ny];
+                }
+            }
+        }
+        if (p.i0 == 0) {
+            std::copy(p.u + F + 1, p.u + F + 1 + ny, faceSend[2] + 2*p.j0);
+            std::copy(p.v + F + 1, p.v + F + 1 + ny, faceSend[2] + faceCount[2]/2 + 2*p.j0);
+        }
+        if (p.i1 == Nxr) {
+            std::copy(p.u + nx*F + 1, p.u + nx*F + 1 + ny, faceSend[3] + 2*p.j0);
+            std::copy(p.v + nx*F + 1, p.v + nx*F + 1 + ny, faceSend[3] + faceCount[3]/2 + 2*p.j0);
+        }
+    }
+}
+
+/**
+ * @brief Advances the fine level over the coarse step from register old to register cur,
+ * then writes it onto the coarse cells of cur (see the class description)
+ * @param old register holding the velocity before the coarse step
+ * @param cur register holding the velocity after it
+ * */
+template <class D>
+void PatchHierarchy<D>::Advance(int old, int cur) {
+    if (refined == 0) return;
+    const double* oldU = decomp->GetU(old);
+    const double* oldV = decomp->GetV(old);
+    double* U = decomp->GetU(cur);
+    double* V = decomp->GetV(cur);
+
+    /// The ghost frame of old was exchanged by the sweep, that of cur is exchanged here
+    int regs[2] = {old, cur};
+    decomp->Start(cur);
+    decomp->Finish();
+    FillCorners(regs, 2);
+    for (int s = 0; s < substeps; s++) {
+        double theta = static_cast<double>(s) / substeps;
+        /* Without halos there is no neighbour to pass the edges to */
+        if (D::OVERLAP) {
+            PackFaces();
+            decomp->ExchangeFaces(faceSend, faceRecv, faceCount);
+        }
+        for (int k = 0; k < npatches; k++) FillGhosts(patches[list[k]], theta, oldU, oldV, U, V);
+        for (int k = 0; k < npatches; k++) Update(patches[list[k]]);
+        for (int k = 0; k < npatches; k++) {
+            Patch &p = patches[list[k]];
+            std::swap(p.u, p.nu);
+            std::swap(p.v, p.nv);
+        }
+    }
+
+    /* cur is overwritten: neighbours must be done reading its edges */
+    decomp->Release();
+    for (int k = 0; k < npatches; k++) Restrict(patches[list[k]], U, V);
+}
+
+/**
+ * @brief One fine substep of a patch into its next fields: the upwind stencil of
+ * BurgersCore::ComputeNextVelocityState with the fine coefficients
+ * */
+template <class D>
+void PatchHierarchy<D>::Update(Patch &p) {
+    int nx = 2*(p.i1 - p.i0);
+    int ny = 2*(p.j1 - p.j0);
+    const double* inU = p.u;
+    const double* inV = p.v;
+    double* outU = p.nu;
+    double* outV = p.nv;
+    for (int a = 1; a <= nx; a++) {
+        for (int b = 1; b <= ny; b++) {
+            int curr = a*F + b;
+            double bdxU = bdx * inU[curr];
+            double bdyV = bdy * inV[curr];
+
+            double alpha_total = alpha - std::fabs(bdxU) - std::fabs(bdyV);
+            double back_x = std::max(bdxU, 0.0) + backX;
+            double back_y = std::max(bdyV, 0.0) + backY;
+            double fwd_x = fwdX - std::min(bdxU, 0.0);
+            double fwd_y = fwdY - std::min(bdyV, 0.0);
+            double nextU = alpha_total * inU[curr];
+            double nextV = alpha_total * inV[curr];
+            nextU += fwd_x * inU[curr+F];
+            nextV += fwd_x * inV[curr+F];
+            nextU += back_x * inU[curr-F];
+            nextV += back_x * inV[curr-F];
+            nextU += fwd_y * inU[curr+1];
+            nextV += fwd_y * inV[curr+1];
+            nextU += back_y * inU[curr-1];
+            nextV += back_y * inV[curr-1];
+            outU[curr] = nextU + inU[curr];
+            outV[curr] = nextV + inV[curr];
+        }
+    }
+}
+
+/**
+ * @brief Copies the fine nodes on coarse nodes into the coarse cells of the patch
+ * */
+template <class D>
+void PatchHierarchy<D>::Restrict(const Patch &p, double* U, double* V) const {
+    for (int i = p.i0; i < p.i1; i++) {
+        for (int j = p.j0; j < p.j1; j++) {
+            int k = (2*(i - p.i0) + 1)*F + 2*(j - p.j0) + 1;
+            U[cs*(i*ld + j)] = p.u[k];
+            V[cs*(i*ld + j)] = p.v[k];
+        }
+    }
+}
+#endif //CLASS_PATCHHIERARCHY
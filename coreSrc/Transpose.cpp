@@ -0,0 +1,46 @@
+#include "Transpose.h"
+
+/// Tile edge: a tile of source columns and destination rows stays resident in L1
+static const int TILE = 32;
+/// Micro-tile edge: unrolled register block
+static const int MICRO = 4;
+
+void TransposeBlocked(const double* src, int ldSrc, double* dst, int ldDst, int rows, int cols) {
+    for (int c0 = 0; c0 < cols; c0 += TILE) {
+        int c1 = (c0 + TILE < cols) ? c0 + TILE : cols;
+        for (int r0 = 0; r0 < rows; r0 += TILE) {
+            int r1 = (r0 + TILE < rows) ? r0 + TILE : rows;
+
+            /// Full micro-tiles: 4 contiguous loads per source column, 4 contiguous stores per row
+            int r = r0;
+            for (; r + MICRO <= r1; r += MICRO) {
+                int c = c0;
+                for (; c + MICRO <= c1; c += MICRO) {
+                    double t[MICRO][MICRO];
+                    for (int cc = 0; cc < MICRO; cc++) {
+                        for (int rr = 0; rr < MICRO; rr++) {
+                            t[rr][cc] = src[(c+cc)*ldSrc + r+rr];
+                        }
+                    }
+                    for (int rr = 0; rr < MICRO; rr++) {
+                        for (int cc = 0; cc < MICRO; cc++) {
+                            dst[(r+rr)*ldDst + c+cc] = t[rr][cc];
+                        }
+                    }
+                }
+                for (; c < c1; c++) {
+                    for (int rr = 0; rr < MICRO; rr++) {
+                        dst[(r+rr)*ldDst + c] = src[c*ldSrc + r+rr];
+                    }
+                }
+            }
+
+            /// Remaining rows of the tile
+            for (; r < r1; r++) {
+                for (int c = c0; c < c1; c++) {
+                    dst[r*ldDst + c] = src[c*ldSrc + r];
+                }
+            }
+        }
+    }
+}
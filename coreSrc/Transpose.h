@@ -0,0 +1,16 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+/**
+ * @brief Cache-blocked conversion of a column-major matrix into row-major storage
+ * Element (r,c) is read from src[c*ldSrc + r] and written to dst[r*ldDst + c]
+ * @param src column-major source
+ * @param ldSrc distance between consecutive columns of src
+ * @param dst row-major destination
+ * @param ldDst distance between consecutive rows of dst
+ * @param rows number of rows
+ * @param cols number of columns
+ * */
+void TransposeBlocked(const double* src, int ldSrc, double* dst, int ldDst, int rows, int cols);
+
+#endif //TRANSPOSE_H
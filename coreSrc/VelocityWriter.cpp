@@ -0,0 +1,132 @@
+#include <charconv>
+#include <cstring>
+#include "Transpose.h"
+#include "VelocityWriter.h"
+
+using namespace std;
+
+/// Size of the output buffer and the longest token that can be formatted ("-1.234e-308 ")
+static const int BUF_SIZE = 1 << 22;
+static const int MAX_TOKEN = 32;
+/// Rows per strip when converting column-major fields
+static const int STRIP_ROWS = 32;
+
+/**
+ * @brief Constructor: opens (truncates) the output file and allocates the buffer
+ * @param filename output file name
+ * */
+VelocityWriter::VelocityWriter(const char* filename) {
+    of.open(filename, ios::out | ios::trunc | ios::binary);
+    buf = new char[BUF_SIZE];
+    used = 0;
+    strip = nullptr;
+    stripSize = 0;
+}
+
+/**
+ * @brief Destructor: flushes remaining output and closes the file
+ * */
+VelocityWriter::~VelocityWriter() {
+    Flush();
+    of.close();
+    delete[] buf;
+    delete[] strip;
+}
+
+/**
+ * @brief Writes a whole field with its zero boundary frame
+ * Element (j,i) of the interior is read from A[j*rowStride + i*colStride]. Column-major fields
+ * (rowStride == 1) are transposed into a small row-major strip with a blocked transpose
+ * @param id Supply 'U' or 'V'
+ * @param A pointer to the interior field
+ * @param rowStride distance between consecutive rows
+ * @param colStride distance between consecutive columns
+ * @param Nyr number of interior rows
+ * @param Nxr number of interior columns
+ * */
+void VelocityWriter::WriteField(char id, const double* A, int rowStride, int colStride, int Nyr, int Nxr) {
+    WriteHeader(id);
+    WriteBoundaryRow(Nxr+2);
+    if (rowStride == 1 && colStride != 1) {
+        if (stripSize < STRIP_ROWS*Nxr) {
+            delete[] strip;
+            stripSize = STRIP_ROWS*Nxr;
+            strip = new double[stripSize];
+        }
+        for (int j0 = 0; j0 < Nyr; j0 += STRIP_ROWS) {
+            int rows = (j0 + STRIP_ROWS < Nyr) ? STRIP_ROWS : Nyr - j0;
+            TransposeBlocked(A + j0, colStride, strip, Nxr, rows, Nxr);
+            for (int j = 0; j < rows; j++) {
+                WriteInteriorRow(strip + j*Nxr, 1, Nxr);
+            }
+        }
+    }
+    else {
+        for (int j = 0; j < Nyr; j++) {
+            WriteInteriorRow(A + j*rowStride, colStride, Nxr);
+        }
+    }
+    WriteBoundaryRow(Nxr+2);
+}
+
+/**
+ * @brief Writes the "<id> velocity field:" header line
+ * */
+void VelocityWriter::WriteHeader(char id) {
+    const char* text = " velocity field:\n";
+    int len = strlen(text);
+    Reserve(len+1);
+    buf[used++] = id;
+    memcpy(buf+used, text, len);
+    used += len;
+}
+
+/**
+ * @brief Writes a row of Nx zeros
+ * */
+void VelocityWriter::WriteBoundaryRow(int Nx) {
+    for (int i = 0; i < Nx; i++) {
+        Reserve(2);
+        buf[used++] = '0';
+        buf[used++] = ' ';
+    }
+    Reserve(1);
+    buf[used++] = '\n';
+}
+
+/**
+ * @brief Writes an interior row enclosed by the zero boundary
+ * @param first pointer to the first interior value of the row
+ * @param stride distance between consecutive values of the row
+ * @param Nxr number of interior values
+ * */
+void VelocityWriter::WriteInteriorRow(const double* first, int stride, int Nxr) {
+    Reserve(2);
+    buf[used++] = '0';
+    buf[used++] = ' ';
+    for (int i = 0; i < Nxr; i++) {
+        Reserve(MAX_TOKEN);
+        char* end = to_chars(buf+used, buf+used+MAX_TOKEN, first[i*stride], chars_format::general, 4).ptr;
+        *end++ = ' ';
+        used = end - buf;
+    }
+    Reserve(3);
+    buf[used++] = '0';
+    buf[used++] = ' ';
+    buf[used++] = '\n';
+}
+
+/**
+ * @brief Makes room for n more bytes, writing the buffer out when it is full
+ * */
+void VelocityWriter::Reserve(int n) {
+    if (used + n > BUF_SIZE) Flush();
+}
+
+/**
+ * @brief Writes the buffered bytes to the file
+ * */
+void VelocityWriter::Flush() {
+    of.write(buf, used);
+    used = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef CLASS_VELOCITYWRITER
+#define CLASS_VELOCITYWRITER
+
+#include <fstream>
+
+/**
+ * @class VelocityWriter
+ * @brief Streams velocity fields into a text file through one large buffer
+ * Values are formatted with std::to_chars to 4 s.f., byte-compatible with ostream precision(4)
+ * Column-major fields are converted to row-major a strip of rows at a time
+ * */
+class VelocityWriter {
+public:
+    explicit VelocityWriter(const char* filename);
+    ~VelocityWriter();
+
+    void WriteField(char id, const double* A, int rowStride, int colStride, int Nyr, int Nxr);
+    void WriteHeader(char id);
+    void WriteBoundaryRow(int Nx);
+    void WriteInteriorRow(const double* first, int stride, int Nxr);
+private:
+    void Reserve(int n);
+    void Flush();
+
+    std::ofstream of;
+    char* buf;
+    int used;
+
+    /// Row-major strip used to convert column-major fields
+    double* strip;
+    int stripSize;
+};
+#endif //CLASS_VELOCITYWRITER
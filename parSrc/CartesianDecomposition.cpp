@@ -0,0 +1,326 @@
+#include <algorithm>
+#include "CartesianDecomposition.h"
+#include "Summation.h"
+#include "Transpose.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: creates the halo exchange and its field arena for the local sub-matrix
+ * @param &m reference to Model instance
+ * @param nregisters (U,V) registers of the arena
+ * */
+CartesianDecomposition::CartesianDecomposition(Model &m, int nregisters)
+    : model(&m), nregisters(nregisters), busy(0.0), workStart(0.0) {
+    halo = new HaloExchange(m, nregisters);
+    SetLocal();
+}
+
+/**
+ * @brief Destructor: frees the halo exchange and its arena
+ * */
+CartesianDecomposition::~CartesianDecomposition() {
+    delete halo;
+}
+
+/**
+ * @brief Caches the size and global offset of the local sub-matrix
+ * */
+void CartesianDecomposition::SetLocal() {
+    Nyr = model->GetLocNyr();
+    Nxr = model->GetLocNxr();
+    displX = model->GetDisplX();
+    displY = model->GetDisplY();
+}
+
+/**
+ * @brief In-place sum of n doubles over all ranks
+ * */
+void CartesianDecomposition::SumAll(double* x, int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, x, n, MPI_DOUBLE, MPI_SUM, model->GetComm());
+}
+
+/**
+ * @brief In-place maximum of n doubles over all ranks
+ * */
+void CartesianDecomposition::MaxAll(double* x, int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, x, n, MPI_DOUBLE, MPI_MAX, model->GetComm());
+}
+
+/**
+ * @brief In-place minimum of n ints over all ranks
+ * */
+void CartesianDecomposition::MinAll(int* x, int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, x, n, MPI_INT, MPI_MIN, model->GetComm());
+}
+
+/**
+ * @brief Passes one buffer to each cartesian neighbour and receives one from it, indexed
+ * (up, down, left, right) like the halos: send[d] goes to the neighbour in direction d and
+ * recv[d] comes from it, count[d] doubles each way (0 skips the direction, and must then be 0
+ * on the other side too); recv[d] is untouched at a wall.
+ * Messages are tagged with the direction they travel in, so the receiver expects d^1
+ * */
+void CartesianDecomposition::ExchangeFaces(double* const* send, double* const* recv, const int* count) const {
+    MPI_Comm vu = model->GetComm();
+    int nbr[4] = {model->GetUp(), model->GetDown(), model->GetLeft(), model->GetRight()};
+    MPI_Request reqs[8];
+    int nreqs = 0;
+    for (int d = 0; d < 4; d++) {
+        if (nbr[d] == MPI_PROC_NULL || count[d] == 0) continue;
+        MPI_Isend(send[d], count[d], MPI_DOUBLE, nbr[d], 24 + d, vu, &reqs[nreqs++]);
+        MPI_Irecv(recv[d], count[d], MPI_DOUBLE, nbr[d], 24 + (d^1), vu, &reqs[nreqs++]);
+    }
+    MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Repartitions the sub-matrices by the compute time of every rank (collective, see
+ * Model::Rebalance). If the partition changes, register r moves to register 0 of a new arena
+ * and the other registers start from zero there, like the ghost frames
+ * @param r register holding the fields to keep
+ * @return whether the partition (and so the arena) changed
+ * */
+bool CartesianDecomposition::Repartition(int r) {
+    int P = model->GetPx() * model->GetPy();
+
+    /// Partition before the repartition, to match old and new owners
+    int* oldNxr = new int[P];
+    int* oldNyr = new int[P];
+    int* oldDisplX = new int[P];
+    int* oldDisplY = new int[P];
+    for (int q = 0; q < P; q++) {
+        oldNxr[q] = model->GetRankNxrMap()[q];
+        oldNyr[q] = model->GetRankNyrMap()[q];
+        oldDisplX[q] = model->GetRankDisplsXMap()[q];
+        oldDisplY[q] = model->GetRankDisplsYMap()[q];
+    }
+
+    bool changed = model->Rebalance(busy);
+    if (changed) {
+        HaloExchange* old = halo;
+        halo = new HaloExchange(*model, nregisters);
+        SetLocal();
+        MigrateFields(old, r, oldNxr, oldNyr, oldDisplX, oldDisplY);
+        delete old;
+    }
+    busy = 0.0;
+
+    delete[] oldNxr;
+    delete[] oldNyr;
+    delete[] oldDisplX;
+    delete[] oldDisplY;
+    return changed;
+}
+
+/**
+ * @brief Moves the velocity in register fromReg of an old arena into register 0 of the current one
+ * Every rank sends the part of its old sub-matrix that each rank now owns and receives the part of
+ * its new sub-matrix from each old owner, directly between the two ranks (itself included)
+ * @param from halo exchange owning the old arena
+ * @param fromReg register holding U, V in the old arena
+ * @param oldNxr, oldNyr, oldDisplX, oldDisplY sizes and global offsets of the old sub-matrices per rank
+ * */
+void CartesianDecomposition::MigrateFields(HaloExchange* from, int fromReg, const int* oldNxr,
+                                           const int* oldNyr, const int* oldDisplX, const int* oldDisplY) {
+    int P = model->GetPx() * model->GetPy();
+    int me = model->GetRank();
+    int cs = halo->GetCellSize();
+    int ncomp = 2 / cs;
+    int ld = halo->GetStorage()->GetLd();
+    int oldLd = from->GetStorage()->GetLd();
+    int* newNxr = model->GetRankNxrMap();
+    int* newNyr = model->GetRankNyrMap();
+    int* newDisplX = model->GetRankDisplsXMap();
+    int* newDisplY = model->GetRankDisplsYMap();
+    MPI_Comm vu = model->GetComm();
+
+    MPI_Request* reqs = new MPI_Request[2*ncomp*P];
+    MPI_Datatype* types = new MPI_Datatype[2*P];
+    int nreqs = 0;
+    int ntypes = 0;
+    for (int q = 0; q < P; q++) {
+        for (int dir = 0; dir < 2; dir++) {
+            /* dir 0: my old cells now owned by q; dir 1: my new cells previously owned by q */
+            int src = (dir == 0) ? me : q;
+            int dst = (dir == 0) ? q : me;
+            int x0 = max(oldDisplX[src], newDisplX[dst]);
+            int x1 = min(oldDisplX[src] + oldNxr[src], newDisplX[dst] + newNxr[dst]);
+            int y0 = max(oldDisplY[src], newDisplY[dst]);
+            int y1 = min(oldDisplY[src] + oldNyr[src], newDisplY[dst] + newNyr[dst]);
+            if (x0 >= x1 || y0 >= y1) continue;
+
+            /// Block of columns: an interleaved column holds both components
+            int stride = (dir == 0) ? oldLd : ld;
+            MPI_Datatype block;
+            MPI_Type_vector(x1 - x0, cs*(y1 - y0), cs*stride, MPI_DOUBLE, &block);
+            MPI_Type_commit(&block);
+            types[ntypes++] = block;
+
+            for (int c = 0; c < ncomp; c++) {
+                if (dir == 0) {
+                    double* f = from->GetStorage()->Field(ncomp*fromReg + c);
+                    f += cs*((x0 - oldDisplX[me])*oldLd + (y0 - oldDisplY[me]));
+                    MPI_Isend(f, 1, block, q, 16 + c, vu, &reqs[nreqs++]);
+                }
+                else {
+                    double* f = halo->GetStorage()->Field(c);
+                    f += cs*((x0 - newDisplX[me])*ld + (y0 - newDisplY[me]));
+                    MPI_Irecv(f, 1, block, q, 16 + c, vu, &reqs[nreqs++]);
+                }
+            }
+        }
+    }
+    MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+
+    for (int k = 0; k < ntypes; k++) MPI_Type_free(&types[k]);
+    delete[] types;
+    delete[] reqs;
+}
+
+/**
+ * @brief Sum of U^2 + V^2 over the whole grid
+ * Reproducible mode: exact local sums, reduced as integers and rounded once
+ * */
+double CartesianDecomposition::SumOfSquares(const double* U, const double* V) const {
+    int cs = halo->GetCellSize();
+    int ld = halo->GetStorage()->GetLd();
+    MPI_Comm vu = model->GetComm();
+
+    if (model->GetEnergyMode() == EnergyMode::Exact) {
+        ExactSum acc;
+        for (int i = 0; i < Nxr; i++) {
+            for (int j = 0; j < Nyr; j++) {
+                int k = cs*(i*ld + j);
+                acc.Add(U[k]*U[k] + V[k]*V[k]);
+            }
+        }
+        acc.Normalise();
+        MPI_Allreduce(MPI_IN_PLACE, acc.Limbs(), ExactSum::LIMBS, MPI_LONG_LONG, MPI_SUM, vu);
+        acc.Normalise();
+        return acc.Value();
+    }
+
+    /// Single fused pass over U and V
+    double sum = ::SumOfSquares(U, V, Nyr, Nxr, cs*ld, cs);
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, vu);
+    return sum;
+}
+
+/**
+ * @brief Sum of wx[i]*wy[j]*(U^2 + V^2) over the whole grid, in the energy mode's reduction
+ * @param wx weight of every local column
+ * @param wy weight of every local row
+ * */
+double CartesianDecomposition::SumOfSquares(const double* U, const double* V, const double* wx, const double* wy) const {
+    int cs = halo->GetCellSize();
+    int ld = halo->GetStorage()->GetLd();
+    MPI_Comm vu = model->GetComm();
+
+    if (model->GetEnergyMode() == EnergyMode::Exact) {
+        ExactSum acc;
+        for (int i = 0; i < Nxr; i++) {
+            for (int j = 0; j < Nyr; j++) {
+                int k = cs*(i*ld + j);
+                acc.Add(wx[i] * (wy[j] * (U[k]*U[k] + V[k]*V[k])));
+            }
+        }
+        acc.Normalise();
+        MPI_Allreduce(MPI_IN_PLACE, acc.Limbs(), ExactSum::LIMBS, MPI_LONG_LONG, MPI_SUM, vu);
+        acc.Normalise();
+        return acc.Value();
+    }
+
+    double sum = ::SumOfSquares(U, V, wx, wy, Nyr, Nxr, cs*ld, cs);
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, vu);
+    return sum;
+}
+
+/**
+ * @brief Writes the velocity field for U, V into a file, gathered on rank 0
+ * */
+void CartesianDecomposition::WriteVelocityFile(const double* U, const double* V) const {
+    /// Get model parameters
+    int Ny = model->GetNy();
+    int Nx = model->GetNx();
+
+    /// Allocate global row-major matrix
+    double* M = new double[(Ny-2)*(Nx-2)];
+
+    /// Open buffered writer to data.txt
+    VelocityWriter writer("data.txt");
+
+    /// Write U velocity
+    WriteOf(U, M, writer, 'U');
+
+    /// Write V velocity
+    WriteOf(V, M, writer, 'V');
+
+    delete[] M;
+}
+
+/**
+ * @brief Private helper function to write to output stream
+ * @param Vel pointer to either U or V
+ * @param M global row-major matrix (should have been allocated memory)
+ * @param &writer reference to the buffered velocity writer
+ * @param id Supply 'U' or 'V'
+ * */
+void CartesianDecomposition::WriteOf(const double* Vel, double* M, VelocityWriter &writer, char id) const {
+    int loc_rank = model->GetRank();
+    int Ny = model->GetNy();
+    int Nx = model->GetNx();
+
+    AssembleMatrix(Vel, M);
+    if (loc_rank == 0) {
+        writer.WriteField(id, M, Nx-2, 1, Ny-2, Nx-2);
+    }
+}
+
+/**
+ * @brief Private helper function that assembles the global matrix into a pre-allocated M
+ * Arranges data into row-major format from a column-major format in the 1D pointer Vel
+ * @param Vel 1D pointer to Vel in column-major format
+ * @param M global matrix (pre-allocated memory, (Ny-2)*(Nx-2)) to be filled in row-major format
+ * */
+void CartesianDecomposition::AssembleMatrix(const double* Vel, double* M) const {
+    /// Get model parameters
+    int loc_rank = model->GetRank();
+    int Ny = model->GetNy();
+    int Nx = model->GetNx();
+    int Px = model->GetPx();
+    int Py = model->GetPy();
+    int cs = halo->GetCellSize();
+    int ld = halo->GetStorage()->GetLd();
+    MPI_Comm vu = model->GetComm();
+
+    /// Don't delete these pointers (Part of Model object)
+    int* displs = model->GetDispls();
+    int* recvcount = model->GetRecvCount();
+    int* rankNxrMap = model->GetRankNxrMap();
+    int* rankNyrMap = model->GetRankNyrMap();
+    int* rankDisplsXMap = model->GetRankDisplsXMap();
+    int* rankDisplsYMap = model->GetRankDisplsYMap();
+
+    /// Gather into globalVel in root (rank == 0), skipping column padding, ghosts and,
+    /// for interleaved cells, the other velocity component
+    MPI_Datatype col, cols;
+    MPI_Type_vector(Nyr, 1, cs, MPI_DOUBLE, &col);
+    MPI_Type_create_hvector(Nxr, 1, static_cast<MPI_Aint>(cs)*ld*sizeof(double), col, &cols);
+    MPI_Type_commit(&cols);
+    double* globalVel = new double[(Ny-2)*(Nx-2)];
+    MPI_Gatherv(Vel, 1, cols, globalVel, recvcount, displs, MPI_DOUBLE, 0, vu);
+    MPI_Type_free(&col);
+    MPI_Type_free(&cols);
+
+    /// Build global matrix in root, blocked column-major -> row-major conversion per sub-matrix
+    if (loc_rank == 0) {
+        for (int k = 0; k < Px*Py; k++) {
+            double* dst = M + rankDisplsYMap[k]*(Nx-2) + rankDisplsXMap[k];
+            TransposeBlocked(globalVel + displs[k], rankNyrMap[k], dst, Nx-2,
+                             rankNyrMap[k], rankNxrMap[k]);
+        }
+    }
+
+    delete[] globalVel;
+}
@@ -0,0 +1,78 @@
+#ifndef CLASS_CARTESIANDECOMPOSITION
+#define CLASS_CARTESIANDECOMPOSITION
+
+#include <mpi.h>
+#include "Model2P.h"
+#include "HaloExchange.h"
+#include "Tridiagonal2P.h"
+#include "VelocityWriter.h"
+
+/**
+ * @class CartesianDecomposition
+ * @brief Decomposition policy of BurgersCore over the cartesian communicator of Model: every rank
+ * owns one sub-matrix of the grid in the field arena of a HaloExchange, whose ghost frames receive
+ * the halos of its neighbours. Reductions run over the communicator, and the compute time measured
+ * between BeginWork() and EndWork() drives the optional repartition (--rebalance)
+ * */
+class CartesianDecomposition {
+public:
+    typedef Model ModelType;
+    typedef Tridiagonal2P Line;
+
+    /// Halos are exchanged while the interior is swept
+    static constexpr bool OVERLAP = true;
+
+    CartesianDecomposition(Model &m, int nregisters);
+    ~CartesianDecomposition();
+
+    FieldStorage* GetStorage() const { return halo->GetStorage(); }
+    double* GetU(int r) const { return halo->GetU(r); }
+    double* GetV(int r) const { return halo->GetV(r); }
+    int GetCellSize() const { return halo->GetCellSize(); }
+    int GetNxr()   const { return Nxr; }
+    int GetNyr()   const { return Nyr; }
+    int GetDisplX() const { return displX; }
+    int GetDisplY() const { return displY; }
+    bool IsRoot()  const { return model->GetRank() == 0; }
+
+    void Start(int r) { halo->Start(r); }
+    void Finish() { halo->Finish(); }
+    void Release() { halo->Release(); }
+    void SumAll(double* x, int n) const;
+    void MaxAll(double* x, int n) const;
+    void MinAll(int* x, int n) const;
+    void ExchangeFaces(double* const* send, double* const* recv, const int* count) const;
+
+    void BeginWork() { workStart = MPI_Wtime(); }
+    void EndWork() { busy += MPI_Wtime() - workStart; }
+    int GetRebalanceInterval() const { return model->GetRebalanceInterval(); }
+    bool Repartition(int r);
+
+    Line* NewLineX() const { return new Tridiagonal2P(Nxr, model->GetComm(), 1); }
+    Line* NewLineY() const { return new Tridiagonal2P(Nyr, model->GetComm(), 0); }
+
+    double SumOfSquares(const double* U, const double* V) const;
+    double SumOfSquares(const double* U, const double* V, const double* wx, const double* wy) const;
+    void WriteVelocityFile(const double* U, const double* V) const;
+private:
+    void SetLocal();
+    void MigrateFields(HaloExchange* from, int fromReg, const int* oldNxr, const int* oldNyr,
+                       const int* oldDisplX, const int* oldDisplY);
+    void AssembleMatrix(const double* Vel, double* M) const;
+    void WriteOf(const double* Vel, double* M, VelocityWriter &writer, char id) const;
+
+    Model* model;
+    HaloExchange* halo;
+    int nregisters;
+
+    /// Local sub-matrix and its global offset
+    int Nyr;
+    int Nxr;
+    int displX;
+    int displY;
+
+    /// Compute time since the last repartition, and the start of the current interval
+    double busy;
+    double workStart;
+};
+#endif //CLASS_CARTESIANDECOMPOSITION
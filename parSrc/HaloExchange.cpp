@@ -0,0 +1,347 @@
+#include <mpi.h>
+#include "HaloExchange.h"
+
+/**
+ * @brief Constructor: allocates the field arena and sets up the selected backend
+ * @param &m reference to Model instance
+ * @param nregisters number of (U,V) registers in the arena
+ * */
+HaloExchange::HaloExchange(Model &m, int nregisters) : model(&m), nregisters(nregisters) {
+    mode = model->GetHaloMode();
+    Nyr = model->GetLocNyr();
+    Nxr = model->GetLocNxr();
+    bool interleaved = model->GetLayout() == Layout::Interleaved;
+    ncomp = interleaved ? 1 : 2;
+    cs = interleaved ? 2 : 1;
+    halo = model->GetHaloWidth();
+    ld = FieldStorage::Stride(Nyr, cs, halo);
+    nreqs = 0;
+
+    /// Neighbours and their sub-matrix sizes
+    int* rankNyrMap = model->GetRankNyrMap();
+    int* rankNxrMap = model->GetRankNxrMap();
+    nbr[0] = model->GetUp();
+    nbr[1] = model->GetDown();
+    nbr[2] = model->GetLeft();
+    nbr[3] = model->GetRight();
+    for (int d = 0; d < 4; d++) {
+        nbrNyr[d] = (nbr[d] == MPI_PROC_NULL) ? 0 : rankNyrMap[nbr[d]];
+        nbrNxr[d] = (nbr[d] == MPI_PROC_NULL) ? 0 : rankNxrMap[nbr[d]];
+    }
+
+    /// Own edges (top rows, bottom rows, first columns, last columns) and the facing ghosts
+    sendOffset[0] = 0;
+    sendOffset[1] = cs*(Nyr-halo);
+    sendOffset[2] = 0;
+    sendOffset[3] = cs*(Nxr-halo)*ld;
+    recvOffset[0] = -cs*halo;
+    recvOffset[1] = cs*Nyr;
+    recvOffset[2] = -cs*halo*ld;
+    recvOffset[3] = cs*Nxr*ld;
+    CreateTypes();
+
+    /// Field arena and backend resources
+    if (mode == HaloMode::Shared) {
+        CreateShared();
+    }
+    else {
+        storage = new FieldStorage(Nyr, Nxr, ncomp*nregisters, cs, halo, model->UseHugePages());
+    }
+    if (mode == HaloMode::Neighbour) CreateNeighbourTypes();
+    if (mode == HaloMode::RMA) CreateRMA();
+}
+
+/**
+ * @brief Destructor: frees backend resources and the field arena
+ * */
+HaloExchange::~HaloExchange() {
+    delete storage;
+    MPI_Type_free(&row);
+    MPI_Type_free(&col);
+
+    if (mode == HaloMode::Neighbour) {
+        for (int k = 0; k < 4*nregisters; k++) {
+            MPI_Type_free(&nbrSendTypes[k]);
+            MPI_Type_free(&nbrRecvTypes[k]);
+        }
+        delete[] nbrSendTypes;
+        delete[] nbrRecvTypes;
+    }
+    if (mode == HaloMode::Shared) {
+        MPI_Win_unlock_all(shmWin);
+        MPI_Win_free(&shmWin);
+        MPI_Comm_free(&nodeComm);
+    }
+    if (mode == HaloMode::RMA) {
+        MPI_Win_free(&rmaWin);
+        MPI_Group_free(&rmaGroup);
+        for (int d = 0; d < 4; d++) {
+            if (nbr[d] != MPI_PROC_NULL) MPI_Type_free(&rmaTarget[d]);
+        }
+    }
+}
+
+/**
+ * @brief Starts filling the ghost frames of register r with the selected backend
+ * */
+void HaloExchange::Start(int r) {
+    switch (mode) {
+        case HaloMode::Neighbour:
+            StartNeighbour(r);
+            break;
+        case HaloMode::Shared:
+            StartShared(r);
+            break;
+        case HaloMode::RMA:
+            StartRMA(r);
+            break;
+        default:
+            StartP2P(r);
+            break;
+    }
+}
+
+/**
+ * @brief Completes the exchange started by Start()
+ * */
+void HaloExchange::Finish() {
+    if (mode == HaloMode::RMA) {
+        MPI_Win_complete(rmaWin);
+        MPI_Win_wait(rmaWin);
+    }
+    else {
+        MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+        nreqs = 0;
+    }
+}
+
+/**
+ * @brief Waits until the neighbours are done with the edges of the last exchanged register, so it
+ * may be overwritten before it is exchanged again. Only the shared backend needs it: neighbours
+ * read our window after their handshake, while the other backends have copied the edges once
+ * Finish() returns. Without it, the next Start() of another register is the release
+ * */
+void HaloExchange::Release() {
+    if (mode != HaloMode::Shared) return;
+
+    MPI_Comm vu = model->GetComm();
+    MPI_Request sync[8];
+    int nsync = 0;
+    for (int d = 0; d < 4; d++) {
+        if (shmNbrArena[d] == nullptr) continue;
+        MPI_Isend(nullptr, 0, MPI_DOUBLE, nbr[d], 8+d, vu, &sync[nsync++]);
+        MPI_Irecv(nullptr, 0, MPI_DOUBLE, nbr[d], 8+(d^1), vu, &sync[nsync++]);
+    }
+    MPI_Waitall(nsync, sync, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Point-to-point messages straight from the edges into the ghost frame
+ * */
+void HaloExchange::StartP2P(int r) {
+    for (int d = 0; d < 4; d++) {
+        if (nbr[d] != MPI_PROC_NULL) PostP2P(r, d);
+    }
+}
+
+/**
+ * @brief Posts the messages of every component of register r to/from the neighbour in direction d
+ * Messages are tagged with the direction they travel in, so the receiver expects d^1
+ * */
+void HaloExchange::PostP2P(int r, int d) {
+    MPI_Comm vu = model->GetComm();
+    MPI_Datatype shape = (d < 2) ? row : col;
+    for (int c = 0; c < ncomp; c++) {
+        MPI_Isend(Component(r, c) + sendOffset[d], 1, shape, nbr[d], d, vu, &reqs[nreqs++]);
+        MPI_Irecv(Component(r, c) + recvOffset[d], 1, shape, nbr[d], d^1, vu, &reqs[nreqs++]);
+    }
+}
+
+/**
+ * @brief Single neighbourhood collective moving the edges of all components of register r
+ * */
+void HaloExchange::StartNeighbour(int r) {
+    MPI_Comm vu = model->GetComm();
+    int counts[4] = {1, 1, 1, 1};
+    MPI_Aint displs[4] = {0, 0, 0, 0};
+    MPI_Ineighbor_alltoallw(MPI_BOTTOM, counts, displs, nbrSendTypes + 4*r,
+                            MPI_BOTTOM, counts, displs, nbrRecvTypes + 4*r, vu, &reqs[0]);
+    nreqs = 1;
+}
+
+/**
+ * @brief On-node neighbours exchange a zero-byte handshake, then their edges are read straight
+ * from the shared window into the ghost frame; off-node neighbours fall back to messages.
+ * The handshake also tells a neighbour that our reads of its previous exchange are done,
+ * so it may overwrite that register
+ * */
+void HaloExchange::StartShared(int r) {
+    MPI_Comm vu = model->GetComm();
+
+    /// Handshake
+    MPI_Request sync[8];
+    int nsync = 0;
+    MPI_Win_sync(shmWin);
+    for (int d = 0; d < 4; d++) {
+        if (shmNbrArena[d] == nullptr) continue;
+        MPI_Isend(nullptr, 0, MPI_DOUBLE, nbr[d], 4+d, vu, &sync[nsync++]);
+        MPI_Irecv(nullptr, 0, MPI_DOUBLE, nbr[d], 4+(d^1), vu, &sync[nsync++]);
+    }
+    MPI_Waitall(nsync, sync, MPI_STATUSES_IGNORE);
+    MPI_Win_sync(shmWin);
+
+    /// Read the facing edges of on-node neighbours (all ranks use the same register indices)
+    for (int d = 0; d < 4; d++) {
+        if (shmNbrArena[d] == nullptr) continue;
+        int nld = FieldStorage::Stride(nbrNyr[d], cs, halo);
+        /* Up: bottom rows, down: top rows, left: last columns, right: first columns */
+        int start[4] = {cs*(nbrNyr[d]-halo), 0, cs*(nbrNxr[d]-halo)*nld, 0};
+        /* Column by column: halo cells of each of Nxr columns, or Nyr cells of each of halo columns */
+        int count = (d < 2) ? Nxr : halo;
+        int len = (d < 2) ? cs*halo : cs*Nyr;
+        for (int c = 0; c < ncomp; c++) {
+            const double* src = shmNbrArena[d] + start[d]
+                              + FieldStorage::FieldOffset(nbrNyr[d], nbrNxr[d], ncomp*r+c, cs, halo);
+            double* dst = Component(r, c) + recvOffset[d];
+            for (int k = 0; k < count; k++) {
+                for (int e = 0; e < len; e++) {
+                    dst[k*cs*ld+e] = src[k*cs*nld+e];
+                }
+            }
+        }
+    }
+
+    /// Messages to off-node neighbours
+    for (int d = 0; d < 4; d++) {
+        if (shmNbrArena[d] == nullptr && nbr[d] != MPI_PROC_NULL) PostP2P(r, d);
+    }
+}
+
+/**
+ * @brief One-sided puts of the edges of register r into the facing ghosts of the neighbours
+ * Epochs are opened with post-start here and closed with complete-wait in Finish()
+ * */
+void HaloExchange::StartRMA(int r) {
+    MPI_Win_post(rmaGroup, 0, rmaWin);
+    MPI_Win_start(rmaGroup, 0, rmaWin);
+    for (int d = 0; d < 4; d++) {
+        if (nbr[d] == MPI_PROC_NULL) continue;
+        MPI_Datatype shape = (d < 2) ? row : col;
+        for (int c = 0; c < ncomp; c++) {
+            MPI_Put(Component(r, c) + sendOffset[d], 1, shape, nbr[d], TargetDisp(d, ncomp*r+c),
+                    1, rmaTarget[d], rmaWin);
+        }
+    }
+}
+
+/**
+ * @brief Window displacement of the ghost edge facing us in field f of the neighbour in direction d
+ * */
+MPI_Aint HaloExchange::TargetDisp(int d, int f) const {
+    int tNyr = nbrNyr[d];
+    int tNxr = nbrNxr[d];
+    MPI_Aint tld = FieldStorage::Stride(tNyr, cs, halo);
+    /* Ghost edges of the target: down rows, up rows, right columns, left columns */
+    MPI_Aint facing[4] = {tNyr, -halo, tNxr*tld, -halo*tld};
+    return FieldStorage::FieldOffset(tNyr, tNxr, f, cs, halo) + cs*facing[d];
+}
+
+/**
+ * @brief Creates the edge shapes: halo rows are strided by the column stride, halo columns are
+ * contiguous runs of Nyr cells (one run for the one-cell halo)
+ * Both move whole cells, so an interleaved edge carries U and V in one message
+ * */
+void HaloExchange::CreateTypes() {
+    MPI_Type_vector(Nxr, cs*halo, cs*ld, MPI_DOUBLE, &row);
+    MPI_Type_commit(&row);
+    MPI_Type_vector(halo, cs*Nyr, cs*ld, MPI_DOUBLE, &col);
+    MPI_Type_commit(&col);
+}
+
+/**
+ * @brief Creates struct types over the edges (send) and ghosts (receive) of the components of
+ * every register, built from absolute addresses for use with MPI_BOTTOM
+ * */
+void HaloExchange::CreateNeighbourTypes() {
+    nbrSendTypes = new MPI_Datatype[4*nregisters];
+    nbrRecvTypes = new MPI_Datatype[4*nregisters];
+    int blocklen[2] = {1, 1};
+    MPI_Aint addr[2];
+    for (int r = 0; r < nregisters; r++) {
+        for (int d = 0; d < 4; d++) {
+            MPI_Datatype shapes[2] = {(d < 2) ? row : col, (d < 2) ? row : col};
+            for (int c = 0; c < ncomp; c++) MPI_Get_address(Component(r, c) + sendOffset[d], &addr[c]);
+            MPI_Type_create_struct(ncomp, blocklen, addr, shapes, &nbrSendTypes[4*r+d]);
+            MPI_Type_commit(&nbrSendTypes[4*r+d]);
+            for (int c = 0; c < ncomp; c++) MPI_Get_address(Component(r, c) + recvOffset[d], &addr[c]);
+            MPI_Type_create_struct(ncomp, blocklen, addr, shapes, &nbrRecvTypes[4*r+d]);
+            MPI_Type_commit(&nbrRecvTypes[4*r+d]);
+        }
+    }
+}
+
+/**
+ * @brief Allocates the arena in a shared-memory window over the ranks of this node
+ * and looks up the arenas of on-node neighbours
+ * */
+void HaloExchange::CreateShared() {
+    MPI_Comm vu = model->GetComm();
+
+    /// Communicator of the ranks sharing memory with this one
+    MPI_Comm_split_type(vu, MPI_COMM_TYPE_SHARED, model->GetRank(), MPI_INFO_NULL, &nodeComm);
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    double* base;
+    MPI_Win_allocate_shared(FieldStorage::Bytes(Nyr, Nxr, ncomp*nregisters, cs, halo), sizeof(double), info,
+                            nodeComm, &base, &shmWin);
+    MPI_Info_free(&info);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, shmWin);
+    storage = new FieldStorage(Nyr, Nxr, ncomp*nregisters, cs, halo, base);
+
+    /// Translate cartesian neighbours into node ranks
+    int nodeNbr[4];
+    MPI_Group vuGroup, nodeGroup;
+    MPI_Comm_group(vu, &vuGroup);
+    MPI_Comm_group(nodeComm, &nodeGroup);
+    MPI_Group_translate_ranks(vuGroup, 4, nbr, nodeGroup, nodeNbr);
+    MPI_Group_free(&vuGroup);
+    MPI_Group_free(&nodeGroup);
+
+    for (int d = 0; d < 4; d++) {
+        shmNbrArena[d] = nullptr;
+        if (nbr[d] == MPI_PROC_NULL || nodeNbr[d] == MPI_UNDEFINED) continue;
+        MPI_Aint size;
+        int disp;
+        MPI_Win_shared_query(shmWin, nodeNbr[d], &size, &disp, &shmNbrArena[d]);
+    }
+}
+
+/**
+ * @brief Exposes the arena in a window and sets up the PSCW group and target ghost shapes
+ * */
+void HaloExchange::CreateRMA() {
+    MPI_Comm vu = model->GetComm();
+    MPI_Win_create(storage->GetArena(), FieldStorage::Bytes(Nyr, Nxr, ncomp*nregisters, cs, halo), sizeof(double),
+                   MPI_INFO_NULL, vu, &rmaWin);
+
+    int members[4];
+    int nmembers = 0;
+    for (int d = 0; d < 4; d++) {
+        if (nbr[d] == MPI_PROC_NULL) continue;
+        int tld = FieldStorage::Stride(nbrNyr[d], cs, halo);
+        if (d < 2) MPI_Type_vector(Nxr, cs*halo, cs*tld, MPI_DOUBLE, &rmaTarget[d]);
+        else MPI_Type_vector(halo, cs*Nyr, cs*tld, MPI_DOUBLE, &rmaTarget[d]);
+        MPI_Type_commit(&rmaTarget[d]);
+
+        /* A rank may neighbour us in more than one direction */
+        bool seen = false;
+        for (int k = 0; k < nmembers; k++) seen = seen || members[k] == nbr[d];
+        if (!seen) members[nmembers++] = nbr[d];
+    }
+
+    MPI_Group vuGroup;
+    MPI_Comm_group(vu, &vuGroup);
+    MPI_Group_incl(vuGroup, nmembers, members, &rmaGroup);
+    MPI_Group_free(&vuGroup);
+}
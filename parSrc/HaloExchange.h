@@ -0,0 +1,84 @@
+#ifndef CLASS_HALOEXCHANGE
+#define CLASS_HALOEXCHANGE
+
+#include <mpi.h>
+#include "Model2P.h"
+#include "FieldStorage.h"
+
+/**
+ * @class HaloExchange
+ * @brief Fills the ghost frames of a (U,V) register pair from the cartesian neighbours
+ * Owns the field arena, since the selected backend decides where the memory lives.
+ * Split layout: register r holds U in field 2r and V in field 2r+1 of the arena.
+ * Interleaved layout: register r is field r, made of (U,V) cells.
+ * Each field of a register is a component moved by its own edge messages.
+ * Edges and ghosts are halo rows or columns deep, the reach of the stencil.
+ * Neighbours, caches and datatypes are indexed (up, down, left, right)
+ * */
+class HaloExchange {
+public:
+    HaloExchange(Model &m, int nregisters);
+    ~HaloExchange();
+
+    FieldStorage* GetStorage() const { return storage; }
+    double* GetU(int r) const { return Component(r, 0); }
+    double* GetV(int r) const { return (ncomp == 2) ? Component(r, 1) : Component(r, 0) + 1; }
+    int GetCellSize() const { return cs; }
+
+    void Start(int r);
+    void Finish();
+    void Release();
+private:
+    double* Component(int r, int c) const { return storage->Field(ncomp*r + c); }
+    void StartP2P(int r);
+    void StartNeighbour(int r);
+    void StartShared(int r);
+    void StartRMA(int r);
+    void PostP2P(int r, int d);
+    MPI_Aint TargetDisp(int d, int f) const;
+    void CreateTypes();
+    void CreateNeighbourTypes();
+    void CreateShared();
+    void CreateRMA();
+
+    Model* model;
+    HaloMode mode;
+    FieldStorage* storage;
+    int nregisters;
+    int ncomp;
+    int cs;
+    int halo;
+    int Nyr;
+    int Nxr;
+    int ld;
+    int nbr[4];
+    int nbrNyr[4];
+    int nbrNxr[4];
+
+    /// Offsets (in doubles) of the sent edge and of the receiving ghost edge from interior cell (0,0)
+    int sendOffset[4];
+    int recvOffset[4];
+
+    /// Edge shapes: halo rows strided by the column stride (up/down) or halo columns (left/right)
+    MPI_Datatype row;
+    MPI_Datatype col;
+
+    /// MPI Requests and Statuses
+    MPI_Request reqs[16];
+    int nreqs;
+
+    /// Neighbourhood collective: struct types over the components per register (absolute addresses)
+    MPI_Datatype* nbrSendTypes;
+    MPI_Datatype* nbrRecvTypes;
+
+    /// Shared-memory window: neighbour arenas, nullptr if off-node
+    MPI_Comm nodeComm;
+    MPI_Win shmWin;
+    double* shmNbrArena[4];
+
+    /// One-sided: arena exposed in a window, synchronised with post-start-complete-wait
+    MPI_Win rmaWin;
+    MPI_Group rmaGroup;
+    MPI_Datatype rmaTarget[4];
+};
+#endif //CLASS_HALOEXCHANGE
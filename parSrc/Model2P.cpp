@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <mpi.h>
 #include <cmath>
+#include <cstring>
 #include "Model2P.h"
 #include "ParseException.h"
 
@@ -18,10 +20,135 @@ Model::Model(int argc, char** argv) {
     ValidateParameters();
 
     MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &loc_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &p);
+    ownsMPI = true;
+    if (IsEnsemble()) {
+        MPI_Comm comm = SplitEnsemble();
+        SetUp(comm);
+        MPI_Comm_free(&comm);
+    }
+    else SetUp(MPI_COMM_WORLD);
+}
+
+/**
+ * @brief Constructor: sets constants from parameters given in code, for embedding the solver
+ * MPI must be initialised; the process grid is created over comm, which needs Px*Py ranks,
+ * and MPI is left for the caller to finalise
+ * @param &params problem, process grid and run-time options
+ * @param comm communicator of the ranks running the solver
+ * */
+Model::Model(const ModelParameters &params, MPI_Comm comm) {
+    SetParameters(params);
+    ValidateParameters();
+    ownsMPI = false;
+    SetUp(comm);
+}
+
+/**
+ * @brief Splits MPI_COMM_WORLD into groups of Px*Py consecutive ranks for ensemble mode
+ * Aborts unless the ranks divide into whole groups, since every rank needs a process grid
+ * @return communicator of this rank's group (to be freed by the caller)
+ * */
+MPI_Comm Model::SplitEnsemble() {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size % (Px*Py) != 0) {
+        if (rank == 0) cout << "ERROR: Ensemble mode needs a multiple of Px*Py ranks" << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    groups = size / (Px*Py);
+    group = rank / (Px*Py);
+
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, group, rank, &comm);
+    return comm;
+}
+
+/**
+ * @brief Creates the process grid over comm and splits the grid among its ranks
+ * Options that the decomposition cannot honour fall back with a warning
+ * @param comm communicator of the ranks running the solver
+ * */
+void Model::SetUp(MPI_Comm comm) {
+    MPI_Comm_rank(comm, &loc_rank);
+    MPI_Comm_size(comm, &p);
     SetGridParameters();
-    SetCartesianGrid();
+    SetCartesianGrid(comm);
+
+    /// ADI and the implicit schemes have one-cell operators of their own
+    if (stencil == Stencil::Central4 && (scheme == Scheme::ADI || IsImplicit())) {
+        if (loc_rank == 0) cout << "WARN: Fourth-order stencils need an explicit scheme, using upwind" << endl;
+        stencil = Stencil::Upwind;
+    }
+    /// The halos of a fourth-order stencil are two cells wide, taken from the adjacent sub-matrix only
+    if (stencil == Stencil::Central4 && (loc_Nxr[Px-1] < 2 || loc_Nyr[Py-1] < 2)) {
+        if (loc_rank == 0) cout << "WARN: Fourth-order stencils need 2 rows and columns per process, using upwind" << endl;
+        stencil = Stencil::Upwind;
+    }
+    /// Central differences put the advection symbol on the imaginary axis, outside the stability
+    /// region of Euler and SSP-RK2; decided once the stencil is known to be kept
+    if (stencil == Stencil::Central4 && (scheme == Scheme::Euler || scheme == Scheme::SSPRK2)) {
+        if (loc_rank == 0) cout << "WARN: Fourth-order stencils need a three-stage Runge-Kutta scheme, using rk3" << endl;
+        scheme = Scheme::SSPRK3;
+        SetNumerics();
+    }
+
+    /// The ADI line solver is tridiagonal: no wrap-around lines
+    if (scheme == Scheme::ADI && boundary == Boundary::Periodic) {
+        if (loc_rank == 0) cout << "WARN: ADI needs Dirichlet boundaries, using Euler" << endl;
+        scheme = Scheme::Euler;
+        SetNumerics();
+    }
+
+    /// The ADI line solver needs distinct first and last cells in every sub-matrix
+    if (scheme == Scheme::ADI && (loc_Nxr[Px-1] < 2 || loc_Nyr[Py-1] < 2)) {
+        if (loc_rank == 0) cout << "WARN: ADI needs 2 rows and columns per process, using Euler" << endl;
+        scheme = Scheme::Euler;
+        SetNumerics();
+    }
+
+    /// The stretched metrics hold the upwind operator of the explicit schemes, between walls
+    if (stretch > 0.0 && (boundary == Boundary::Periodic || scheme == Scheme::ADI || IsImplicit()
+                          || stencil == Stencil::Central4)) {
+        if (loc_rank == 0) cout << "WARN: Stretched grids need Dirichlet boundaries, the upwind stencil and an explicit scheme, using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+    /// The finest spacing is well below the explicit limit of the fixed dt, set for the uniform grid
+    if (stretch > 0.0 && cfl <= 0.0) {
+        if (loc_rank == 0) cout << "WARN: Stretched grids need an adaptive time step (--cfl), using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+
+    /// The patches advance the upwind Euler step of a uniform grid between walls, at a fixed dt
+    if (amr > 0.0 && (scheme != Scheme::Euler || stencil != Stencil::Upwind || stretch > 0.0
+                      || boundary == Boundary::Periodic || cfl > 0.0)) {
+        if (loc_rank == 0) cout << "WARN: Refinement needs the Euler scheme, the upwind stencil, a uniform grid, Dirichlet boundaries and a fixed time step, disabled" << endl;
+        amr = 0.0;
+    }
+    /// The patches are laid over the sub-matrices they were flagged on
+    if (rebalance > 0 && amr > 0.0) {
+        if (loc_rank == 0) cout << "WARN: Rebalancing does not move refined patches, disabled" << endl;
+        rebalance = 0;
+    }
+
+    /// Only the velocity moves with the cells; the implicit solvers keep state of their own
+    if (rebalance > 0 && IsImplicit()) {
+        if (loc_rank == 0) cout << "WARN: Rebalancing needs an explicit or ADI scheme, disabled" << endl;
+        rebalance = 0;
+    }
+
+    /// A periodic dimension of 1 or 2 ranks lists the same rank on both sides, and the
+    /// neighbourhood collective cannot tell its two faces apart
+    if (haloMode == HaloMode::Neighbour && boundary == Boundary::Periodic && (Px <= 2 || Py <= 2)) {
+        if (loc_rank == 0) cout << "WARN: Neighbourhood halos need 3 processes along each periodic dimension, using p2p" << endl;
+        haloMode = HaloMode::PointToPoint;
+    }
+
+    /// The access epochs of a single rank have no other rank to synchronise with
+    if (haloMode == HaloMode::RMA && p == 1) {
+        if (loc_rank == 0) cout << "WARN: One-sided halos need 2 or more processes, using p2p" << endl;
+        haloMode = HaloMode::PointToPoint;
+    }
 }
 
 /**
@@ -39,15 +166,33 @@ Model::~Model() {
     delete[] rankNyrMap;
     delete[] rankDisplsXMap;
     delete[] rankDisplsYMap;
-    MPI_Finalize();
+    MPI_Comm_free(&vu);
+    if (ownsMPI) MPI_Finalize();
 }
 
 /**
  * @brief Parses parameters from command line into program
+ * Positional parameters may be followed by optional --key=value switches
  * Throws an exception if invalid number of arguments are supplied
  * */
 void Model::ParseParameters(int argc, char **argv) {
-    if (argc == 10) {
+    /// Defaults for optional switches
+    cfl = 0.0;
+    scheme = Scheme::Euler;
+    haloMode = HaloMode::PointToPoint;
+    energyMode = EnergyMode::Compensated;
+    layout = Layout::Split;
+    profile = Profile::Bump;
+    boundary = Boundary::Dirichlet;
+    stencil = Stencil::Upwind;
+    stretch = 0.0;
+    amr = 0.0;
+    hugePages = false;
+    rebalance = 0;
+    group = 0;
+    groups = 1;
+
+    if (argc >= 10) {
         ax = atof(argv[1]);
         ay = atof(argv[2]);
         b = atof(argv[3]);
@@ -57,10 +202,121 @@ void Model::ParseParameters(int argc, char **argv) {
         T = atof(argv[7]);
         Px = atoi(argv[8]);
         Py = atoi(argv[9]);
+        for (int k = 10; k < argc; k++) {
+            ParseOption(argv[k]);
+        }
     }
     else throw illegalArgumentException;
 }
 
+/**
+ * @brief Parses a single optional --key=value switch
+ * Unknown switches are reported and ignored
+ * @param opt switch as supplied on the command line
+ * */
+void Model::ParseOption(const char* opt) {
+    if (strcmp(opt, "--halo=p2p") == 0) haloMode = HaloMode::PointToPoint;
+    else if (strcmp(opt, "--halo=neighbour") == 0) haloMode = HaloMode::Neighbour;
+    else if (strcmp(opt, "--halo=shared") == 0) haloMode = HaloMode::Shared;
+    else if (strcmp(opt, "--halo=rma") == 0) haloMode = HaloMode::RMA;
+    else if (strcmp(opt, "--energy=compensated") == 0) energyMode = EnergyMode::Compensated;
+    else if (strcmp(opt, "--energy=exact") == 0) energyMode = EnergyMode::Exact;
+    else if (strcmp(opt, "--layout=split") == 0) layout = Layout::Split;
+    else if (strcmp(opt, "--layout=interleaved") == 0) layout = Layout::Interleaved;
+    else if (strcmp(opt, "--init=bump") == 0) profile = Profile::Bump;
+    else if (strcmp(opt, "--init=gaussian") == 0) profile = Profile::Gaussian;
+    else if (strcmp(opt, "--bc=dirichlet") == 0) boundary = Boundary::Dirichlet;
+    else if (strcmp(opt, "--bc=periodic") == 0) boundary = Boundary::Periodic;
+    else if (strcmp(opt, "--stencil=upwind") == 0) stencil = Stencil::Upwind;
+    else if (strcmp(opt, "--stencil=central4") == 0) stencil = Stencil::Central4;
+    else if (strcmp(opt, "--hugepages") == 0) hugePages = true;
+    else if (strcmp(opt, "--scheme=euler") == 0) scheme = Scheme::Euler;
+    else if (strcmp(opt, "--scheme=adi") == 0) scheme = Scheme::ADI;
+    else if (strcmp(opt, "--scheme=rk2") == 0) scheme = Scheme::SSPRK2;
+    else if (strcmp(opt, "--scheme=rk3") == 0) scheme = Scheme::SSPRK3;
+    else if (strcmp(opt, "--scheme=lsrk3") == 0) scheme = Scheme::LSRK3;
+    else if (strcmp(opt, "--scheme=lsrk4") == 0) scheme = Scheme::LSRK4;
+    else if (strcmp(opt, "--scheme=implicit") == 0) scheme = Scheme::Implicit;
+    else if (strcmp(opt, "--scheme=cn") == 0) scheme = Scheme::CrankNicolson;
+    else if (strncmp(opt, "--ensemble=", 11) == 0) ensembleFile = opt + 11;
+    else if (strncmp(opt, "--rebalance=", 12) == 0) {
+        rebalance = atoi(opt + 12);
+        if (rebalance < 0) {
+            cout << "WARN: Rebalance interval has to be (>=0), rebalancing disabled" << endl;
+            rebalance = 0;
+        }
+    }
+    else if (strncmp(opt, "--stretch=", 10) == 0) {
+        stretch = atof(opt + 10);
+        if (!(stretch >= 0.0)) {
+            cout << "WARN: Stretching has to be (>=0), using a uniform grid" << endl;
+            stretch = 0.0;
+        }
+    }
+    else if (strncmp(opt, "--amr=", 6) == 0) {
+        amr = atof(opt + 6);
+        if (!(amr >= 0.0)) {
+            cout << "WARN: Refinement threshold has to be (>=0), refinement disabled" << endl;
+            amr = 0.0;
+        }
+    }
+    else if (strncmp(opt, "--cfl=", 6) == 0) {
+        cfl = atof(opt + 6);
+        if (!(cfl > 0.0 && cfl <= 1.0)) {
+            cout << "WARN: CFL number has to be in (0,1], using fixed time step" << endl;
+            cfl = 0.0;
+        }
+    }
+    else cout << "WARN: Unknown option " << opt << " ignored" << endl;
+}
+
+/**
+ * @brief Copies the problem, the process grid and the options from a parameter set
+ * Out-of-range values fall back as with the command line switches
+ * @param &params problem, process grid and run-time options
+ * */
+void Model::SetParameters(const ModelParameters &params) {
+    ax = params.ax;
+    ay = params.ay;
+    b = params.b;
+    c = params.c;
+    Lx = params.Lx;
+    Ly = params.Ly;
+    T = params.T;
+    Px = params.Px;
+    Py = params.Py;
+    cfl = params.cfl;
+    scheme = params.scheme;
+    haloMode = params.haloMode;
+    energyMode = params.energyMode;
+    layout = params.layout;
+    profile = params.profile;
+    boundary = params.boundary;
+    stencil = params.stencil;
+    stretch = params.stretch;
+    amr = params.amr;
+    hugePages = params.hugePages;
+    rebalance = params.rebalance;
+    group = 0;
+    groups = 1;
+    if (rebalance < 0) {
+        cout << "WARN: Rebalance interval has to be (>=0), rebalancing disabled" << endl;
+        rebalance = 0;
+    }
+    if (cfl != 0.0 && !(cfl > 0.0 && cfl <= 1.0)) {
+        cout << "WARN: CFL number has to be in (0,1], using fixed time step" << endl;
+        cfl = 0.0;
+    }
+    if (!(stretch >= 0.0)) {
+        cout << "WARN: Stretching has to be (>=0), using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+    if (!(amr >= 0.0)) {
+        cout << "WARN: Refinement threshold has to be (>=0), refinement disabled" << endl;
+        amr = 0.0;
+    }
+}
+
 /**
  * @brief Prints model parameters
  * */
@@ -75,6 +331,22 @@ void Model::PrintParameters() {
         cout << "T: " << T << endl;
         cout << "Px: " << Px << endl;
         cout << "Py: " << Py << endl;
+        const char* halo[4] = {"p2p", "neighbour", "shared", "rma"};
+        cout << "Halo: " << halo[static_cast<int>(haloMode)] << endl;
+        cout << "Energy: " << (energyMode == EnergyMode::Exact ? "exact" : "compensated") << endl;
+        cout << "Layout: " << (layout == Layout::Interleaved ? "interleaved" : "split") << endl;
+        cout << "Initial profile: " << (profile == Profile::Gaussian ? "gaussian" : "bump") << endl;
+        cout << "Boundary: " << (boundary == Boundary::Periodic ? "periodic" : "dirichlet") << endl;
+        cout << "Stencil: " << (stencil == Stencil::Central4 ? "central4" : "upwind") << endl;
+        if (stretch > 0.0) cout << "Grid: stretched, factor " << stretch << endl;
+        else cout << "Grid: uniform" << endl;
+        if (amr > 0.0) cout << "Refinement: threshold " << amr << endl;
+        const char* schemes[8] = {"euler", "adi", "rk2", "rk3", "lsrk3", "lsrk4", "implicit", "cn"};
+        cout << "Scheme: " << schemes[static_cast<int>(scheme)] << endl;
+        if (cfl > 0.0) cout << "Time step: adaptive, CFL " << cfl << endl;
+        else cout << "Time step: fixed" << endl;
+        if (rebalance > 0) cout << "Rebalance: every " << rebalance << " steps" << endl;
+        if (IsEnsemble()) cout << "Ensemble: " << ensembleFile << ", " << groups << " groups" << endl;
     }
 }
 
@@ -82,14 +354,14 @@ void Model::PrintParameters() {
  * @brief Checks if parameters supplied are valid
  * */
 bool Model::IsValid() {
-    return ax >= 0 && ay >= 0 && b >= 0 && c >= 0 && Lx >= 0 && Ly >= 0 && T >= 0;
+    return c >= 0 && Lx >= 0 && Ly >= 0 && T >= 0;
 }
 
 /**
  * @brief Validates the parameters. If parameters supplied are valid, set them as instance vars
  * */
 void Model::ValidateParameters() {
-    if (!IsValid()) cout << "WARN: Parameter values have to be (>=0)" << endl;
+    if (!IsValid()) cout << "WARN: c, Lx, Ly and T have to be (>=0)" << endl;
     else SetNumerics();
 }
 
@@ -101,35 +373,145 @@ void Model::SetNumerics() {
     Ny = 501;
     Nt = 501;
     /// dx,dy and dt are dependent on L,T and Nx,Ny,Nt:
-    dx = Lx / (Nx-1);
-    dy = Ly / (Ny-1);
+    /// periodic: the Nx-2 interior columns (Ny-2 rows) span one period, the ghosts repeat them
+    int cellsX = (boundary == Boundary::Periodic) ? Nx-2 : Nx-1;
+    int cellsY = (boundary == Boundary::Periodic) ? Ny-2 : Ny-1;
+    dx = Lx / cellsX;
+    dy = Ly / cellsY;
     dt = T / (Nt-1);
     /// x0 and y0 represent the top LHS of the matrix:
     x0 = -Lx/2.0;
     y0 = Ly/2.0;
+    /// stretched grid: the metrics take over from dx, dy in the sweep, profile and energy
+    if (stretch > 0.0) {
+        metricX.Set(Nx, x0, Lx, 1.0, stretch);
+        metricY.Set(Ny, y0, Ly, -1.0, stretch);
+        metricX.SetCoefficients(ax, b, c);
+        metricY.SetCoefficients(ay, b, c);
+    }
     /// b/dx and b/dy saves computation time in the future
-    bdx = b/dx;
-    bdy = b/dy;
+    bdx_rate = b/dx;
+    bdy_rate = b/dy;
     /// constants used in SetIntegratedVelocity()
     double alpha_dx_2 = (-2.0*c)/pow(dx,2.0);
     double alpha_dy_2 = (-2.0*c)/pow(dy,2.0);
-    double alpha_dx_1 = -ax/dx;
-    double alpha_dy_1 = -ay/dy;
-    double beta_dx_1 = ax/dx;
-    double beta_dy_1 = ay/dy;
-    beta_dx_2 = c/pow(dx,2.0);
-    beta_dy_2 = c/pow(dy,2.0);
-    alpha_sum = alpha_dx_1 + alpha_dx_2 + alpha_dy_1 + alpha_dy_2;
-    beta_dx_sum = beta_dx_1 + beta_dx_2;
-    beta_dy_sum = beta_dy_1 + beta_dy_2;
+    /// linear advection is upwinded once per run: from behind (i-1, j-1) for positive ax, ay,
+    /// from ahead (i+1, j+1) for negative ones
+    double alpha_dx_1 = -fabs(ax)/dx;
+    double alpha_dy_1 = -fabs(ay)/dy;
+    double beta_dx_1 = max(ax, 0.0)/dx;
+    double beta_dy_1 = max(ay, 0.0)/dy;
+    double gamma_dx_1 = max(-ax, 0.0)/dx;
+    double gamma_dy_1 = max(-ay, 0.0)/dy;
+    diff_x_rate = c/pow(dx,2.0);
+    diff_y_rate = c/pow(dy,2.0);
+    beta_dx_2_rate = diff_x_rate + gamma_dx_1;
+    beta_dy_2_rate = diff_y_rate + gamma_dy_1;
+    alpha_sum_rate = alpha_dx_1 + alpha_dx_2 + alpha_dy_1 + alpha_dy_2;
+    beta_dx_sum_rate = beta_dx_1 + diff_x_rate;
+    beta_dy_sum_rate = beta_dy_1 + diff_y_rate;
+    /// ADI: diffusion leaves the explicit update and is solved along x and y lines instead
+    if (scheme == Scheme::ADI) {
+        alpha_sum_rate = alpha_dx_1 + alpha_dy_1;
+        beta_dx_sum_rate = beta_dx_1;
+        beta_dy_sum_rate = beta_dy_1;
+        beta_dx_2_rate = gamma_dx_1;
+        beta_dy_2_rate = gamma_dy_1;
+    }
     /// multiply by dt for pre-computational purposes
-    bdx *= dt;
-    bdy *= dt;
-    alpha_sum *= dt;
-    beta_dx_sum *= dt;
-    beta_dy_sum *= dt;
-    beta_dx_2 *= dt;
-    beta_dy_2 *= dt;
+    SetTimeStep(dt);
+}
+
+/**
+ * @brief Replaces the physical parameters and recomputes the numerics, the time step included
+ * Used to run several cases on one Model (ensemble mode)
+ * @return false, leaving the parameters and numerics unchanged, if c is negative
+ * */
+bool Model::SetPhysics(double ax, double ay, double b, double c) {
+    if (!(c >= 0)) return false;
+    this->ax = ax;
+    this->ay = ay;
+    this->b = b;
+    this->c = c;
+    SetNumerics();
+    return true;
+}
+
+/**
+ * @brief Sets the time step and recomputes every constant that is multiplied by it
+ * @param newDt time step
+ * */
+void Model::SetTimeStep(double newDt) {
+    dt = newDt;
+    bdx = bdx_rate * dt;
+    bdy = bdy_rate * dt;
+    alpha_sum = alpha_sum_rate * dt;
+    beta_dx_sum = beta_dx_sum_rate * dt;
+    beta_dy_sum = beta_dy_sum_rate * dt;
+    beta_dx_2 = beta_dx_2_rate * dt;
+    beta_dy_2 = beta_dy_2_rate * dt;
+    rx = 0.5 * diff_x_rate * dt;
+    ry = 0.5 * diff_y_rate * dt;
+    if (stretch > 0.0) {
+        metricX.Scale(dt);
+        metricY.Scale(dt);
+    }
+}
+
+/**
+ * @brief Largest time step allowed by the CFL number for the given velocity magnitudes
+ * The upwind advection limit (|ax| + |b||U|)/dx + (|ay| + |b||V|)/dy and the diffusion limit
+ * 2c/dx^2 + 2c/dy^2 are combined, which keeps every coefficient of the update non-negative.
+ * With ADI, backward Euler and Crank-Nicolson the diffusion is implicit and only the
+ * advection limit applies. The limit is scaled by the stability radius of the integrator.
+ * Central fourth-order stencils: the advection symbol reaches 1.372 ((|ax| + |b||U|)/dx + (|ay| + |b||V|)/dy)
+ * on the imaginary axis, within ImaginaryBound(), and the diffusion symbol 16c/3 (1/dx^2 + 1/dy^2)
+ * on the negative real axis, within 2R; the two fractions of their bounds add up to the CFL number.
+ * On a stretched grid the smallest spacings stand for dx, dy, which bounds every cell
+ * @param maxU largest |U| over the domain
+ * @param maxV largest |V| over the domain
+ * */
+double Model::StableTimeStep(double maxU, double maxV) const {
+    double dx = IsStretched() ? metricX.GetMinSpacing() : this->dx;
+    double dy = IsStretched() ? metricY.GetMinSpacing() : this->dy;
+    if (stencil == Stencil::Central4) {
+        double adv = 1.372*((fabs(ax) + fabs(b)*maxU)/dx + (fabs(ay) + fabs(b)*maxV)/dy);
+        double dif = 16.0/3.0*c*(1.0/(dx*dx) + 1.0/(dy*dy));
+        double rate = adv/ImaginaryBound() + dif/(2.0*StabilityRadius());
+        return (rate > 0.0) ? cfl/rate : T;
+    }
+    double rate = (fabs(ax) + fabs(b)*maxU)/dx + (fabs(ay) + fabs(b)*maxV)/dy;
+    if (scheme != Scheme::ADI && !IsImplicit()) rate += 2.0*c/(dx*dx) + 2.0*c/(dy*dy);
+    return (rate > 0.0) ? cfl*StabilityRadius()/rate : T;
+}
+
+/**
+ * @brief Radius of the largest disk |z + R| <= R inside the stability region of the explicit
+ * integrator (rounded down). The upwind and diffusion symbols of an Euler-stable step fill the
+ * disk of radius 1, so R is the factor by which a step may exceed the Euler limit
+ * */
+double Model::StabilityRadius() const {
+    switch (scheme) {
+        case Scheme::SSPRK3:
+        case Scheme::LSRK3: return 1.25;
+        case Scheme::LSRK4: return 2.2;
+        default: return 1.0;
+    }
+}
+
+/**
+ * @brief Half-length of the imaginary interval inside the stability region of the explicit
+ * integrator (rounded down), which bounds central advection: sqrt(3) for the three-stage
+ * third-order schemes, 3.34 for the five-stage fourth-order one. Euler and SSP-RK2 have none
+ * (central stencils switch them to SSP-RK3)
+ * */
+double Model::ImaginaryBound() const {
+    switch (scheme) {
+        case Scheme::SSPRK3:
+        case Scheme::LSRK3: return 1.7;
+        case Scheme::LSRK4: return 3.3;
+        default: return 0.0;
+    }
 }
 
 /**
@@ -179,6 +561,33 @@ void Model::SetGridParameters() {
     rankNyrMap = new int[Px*Py];
     rankDisplsXMap = new int[Px*Py];
     rankDisplsYMap = new int[Px*Py];
+    SetRankMaps();
+
+    /// Print result
+    if (loc_rank == 0) {
+        for (int j = 0; j < Py; j++) {
+            for (int i = 0; i < Px; i++) {
+                cout << "(" << loc_Nyr[j] << "," << loc_Nxr[i] << ")" << ' ';
+            }
+            cout << endl;
+        }
+    }
+}
+
+/**
+ * @brief Sets the displacements and the per-rank maps from the column and row splits loc_Nxr, loc_Nyr
+ * */
+void Model::SetRankMaps() {
+    int sum = 0;
+    for (int i = 0; i < Px; i++) {
+        displs_x[i] = sum;
+        sum += loc_Nxr[i];
+    }
+    sum = 0;
+    for (int j = 0; j < Py; j++) {
+        displs_y[j] = sum;
+        sum += loc_Nyr[j];
+    }
 
     /* Layout of cartesian grid in row-major format */
     sum = 0;
@@ -193,29 +602,118 @@ void Model::SetGridParameters() {
             sum += recvcount[j*Px+i];
         }
     }
+}
 
-    /// Print result
-    if (loc_rank == 0) {
-        for (int j = 0; j < Py; j++) {
-            for (int i = 0; i < Px; i++) {
-                cout << "(" << loc_Nyr[j] << "," << loc_Nxr[i] << ")" << ' ';
-            }
+/**
+ * @brief Splits n cells into parts of contiguous cells with nearly equal cost
+ * Part k ends at the cell whose midpoint reaches k+1 parts of the total cost, at least minCells
+ * wide. The new split is only taken if it lowers the costliest part by 10% or more
+ * @param cost cost of every cell
+ * @param n number of cells
+ * @param parts number of parts
+ * @param minCells smallest part
+ * @param sizes current part sizes, replaced by the new ones
+ * @return true if the sizes changed
+ * */
+static bool BalanceSplit(const double* cost, int n, int parts, int minCells, int* sizes) {
+    double total = 0.0;
+    double oldMax = 0.0;
+    int start = 0;
+    for (int k = 0; k < parts; k++) {
+        double part = 0.0;
+        for (int g = start; g < start + sizes[k]; g++) part += cost[g];
+        oldMax = max(oldMax, part);
+        total += part;
+        start += sizes[k];
+    }
+    if (!(total > 0.0)) return false;
+
+    int* next = new int[parts];
+    double newMax = 0.0;
+    double cum = 0.0;
+    start = 0;
+    for (int k = 0; k < parts; k++) {
+        int end = n;
+        if (k < parts-1) {
+            double target = total * (k+1) / parts;
+            double c = cum;
+            end = start;
+            while (end < n && c + 0.5*cost[end] < target) c += cost[end++];
+            end = min(max(end, start + minCells), n - (parts-1-k)*minCells);
+        }
+        double part = 0.0;
+        for (int g = start; g < end; g++) part += cost[g];
+        newMax = max(newMax, part);
+        cum += part;
+        next[k] = end - start;
+        start = end;
+    }
+
+    bool changed = newMax < 0.9*oldMax;
+    if (changed) {
+        for (int k = 0; k < parts; k++) sizes[k] = next[k];
+    }
+    delete[] next;
+    return changed;
+}
+
+/**
+ * @brief Repartitions the column and row splits by the work measured on every rank (collective)
+ * A rank's busy time is spread evenly over its cells; the per-column and per-row sums of these
+ * costs are split into Px and Py parts of nearly equal cost. The neighbours and the process
+ * grid stay the same, only loc_Nxr, loc_Nyr and the maps built from them change
+ * @param busy compute time of the local sub-matrix since the last call
+ * @return true if the splits changed, in which case the fields have to move to their new owners
+ * */
+bool Model::Rebalance(double busy) {
+    int Nxr = Nx - 2;
+    int Nyr = Ny - 2;
+    double* times = new double[p];
+    MPI_Allgather(&busy, 1, MPI_DOUBLE, times, 1, MPI_DOUBLE, vu);
+
+    double* colCost = new double[Nxr]();
+    double* rowCost = new double[Nyr]();
+    for (int j = 0; j < Py; j++) {
+        for (int i = 0; i < Px; i++) {
+            double cell = times[j*Px+i] / (static_cast<double>(loc_Nyr[j]) * loc_Nxr[i]);
+            for (int g = displs_x[i]; g < displs_x[i] + loc_Nxr[i]; g++) colCost[g] += cell * loc_Nyr[j];
+            for (int g = displs_y[j]; g < displs_y[j] + loc_Nyr[j]; g++) rowCost[g] += cell * loc_Nxr[i];
+        }
+    }
+
+    /// At least two cells per process where the grid allows it (ADI needs them, see the constructor)
+    bool changedX = BalanceSplit(colCost, Nxr, Px, min(2, Nxr/Px), loc_Nxr);
+    bool changedY = BalanceSplit(rowCost, Nyr, Py, min(2, Nyr/Py), loc_Nyr);
+    if (changedX || changedY) {
+        SetRankMaps();
+        if (loc_rank == 0) {
+            cout << "Rebalanced (Nyr,Nxr):";
+            for (int j = 0; j < Py; j++) cout << ' ' << loc_Nyr[j];
+            cout << " /";
+            for (int i = 0; i < Px; i++) cout << ' ' << loc_Nxr[i];
             cout << endl;
         }
     }
+
+    delete[] times;
+    delete[] colCost;
+    delete[] rowCost;
+    return changedX || changedY;
 }
 
 /**
  * @brief Sets up a cartesian grid of Px * Py processors and identifies local neighbours
+ * @param comm communicator the grid is created over
  * */
-void Model::SetCartesianGrid() {
+void Model::SetCartesianGrid(MPI_Comm comm) {
     int dim[2] = {Py, Px};
-    int period[2] = {0,0};
+    int periodic = (boundary == Boundary::Periodic) ? 1 : 0;
+    int period[2] = {periodic, periodic};
     int reorder = 1;
     loc_coord = new int[2];
 
     /// Create cartesian grid of processes
-    MPI_Cart_create(MPI_COMM_WORLD, 2, dim, period, reorder, &vu);
+    MPI_Cart_create(comm, 2, dim, period, reorder, &vu);
 
     /// Recast loc_rank and p wrt vu
     MPI_Comm_rank(vu, &loc_rank);
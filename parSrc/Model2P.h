@@ -2,6 +2,43 @@
 #define CLASS_MODEL2P
 
 #include <mpi.h>
+#include <string>
+#include "GridMetric.h"
+#include "Options.h"
+
+/// Halo exchange backends selectable with --halo=
+enum class HaloMode { PointToPoint, Neighbour, Shared, RMA };
+
+/// Energy reductions selectable with --energy=
+enum class EnergyMode { Compensated, Exact };
+
+/**
+ * @brief Problem, process grid and run-time options of a Model built in code
+ * (see Model(const ModelParameters&, MPI_Comm)). The options default to those of the command line switches
+ * */
+struct ModelParameters {
+    double ax = 0.0;
+    double ay = 0.0;
+    double b = 0.0;
+    double c = 0.0;
+    double Lx = 10.0;
+    double Ly = 10.0;
+    double T = 1.0;
+    int Px = 1;
+    int Py = 1;
+    double cfl = 0.0;
+    Scheme scheme = Scheme::Euler;
+    HaloMode haloMode = HaloMode::PointToPoint;
+    EnergyMode energyMode = EnergyMode::Compensated;
+    Layout layout = Layout::Split;
+    Profile profile = Profile::Bump;
+    Boundary boundary = Boundary::Dirichlet;
+    Stencil stencil = Stencil::Upwind;
+    double stretch = 0.0;
+    double amr = 0.0;
+    bool hugePages = false;
+    int rebalance = 0;
+};
 
 /**
  * @class Model
@@ -10,12 +47,20 @@
 class Model {
 public:
     Model(int argc, char* argv[]);
+    Model(const ModelParameters &params, MPI_Comm comm);
     ~Model();
 
     void PrintParameters();
 
     bool IsValid();
 
+    bool SetPhysics(double ax, double ay, double b, double c);
+    void SetTimeStep(double newDt);
+    double StableTimeStep(double maxU, double maxV) const;
+    double StabilityRadius() const;
+    double ImaginaryBound() const;
+    bool Rebalance(double busy);
+
     /// Generic getters
     bool   IsVerbose() const { return verbose; }
     bool   IsHelp()    const { return help; }
@@ -41,6 +86,33 @@ public:
     double GetBetaDx_Sum() const { return beta_dx_sum; }
     double GetBetaDy_Sum() const { return beta_dy_sum; }
     double GetAlpha_Sum() const { return alpha_sum; }
+    double GetCFL()    const { return cfl; }
+    bool   IsAdaptive() const { return cfl > 0.0; }
+    Scheme GetScheme() const { return scheme; }
+    bool   IsImplicit() const { return scheme == Scheme::Implicit || scheme == Scheme::CrankNicolson; }
+    double GetTheta()  const { return (scheme == Scheme::CrankNicolson) ? 0.5 : 1.0; }
+    double GetRx()     const { return rx; }
+    double GetRy()     const { return ry; }
+    HaloMode GetHaloMode() const { return haloMode; }
+    EnergyMode GetEnergyMode() const { return energyMode; }
+    Layout GetLayout() const { return layout; }
+    Profile GetProfile() const { return profile; }
+    Boundary GetBoundary() const { return boundary; }
+    bool   IsPeriodic() const { return boundary == Boundary::Periodic; }
+    Stencil GetStencil() const { return stencil; }
+    int    GetHaloWidth() const { return (stencil == Stencil::Central4) ? 2 : 1; }
+    bool   IsStretched() const { return stretch > 0.0; }
+    double GetStretch() const { return stretch; }
+    bool   IsRefined() const { return amr > 0.0; }
+    double GetAMRThreshold() const { return amr; }
+    const GridMetric& GetMetricX() const { return metricX; }
+    const GridMetric& GetMetricY() const { return metricY; }
+    bool   UseHugePages() const { return hugePages; }
+    int    GetRebalanceInterval() const { return rebalance; }
+    bool   IsEnsemble() const { return !ensembleFile.empty(); }
+    const char* GetEnsembleFile() const { return ensembleFile.c_str(); }
+    int    GetEnsembleGroup()  const { return group; }
+    int    GetEnsembleGroups() const { return groups; }
 
     // Add any other getters here...
 
@@ -67,12 +139,17 @@ public:
 
 private:
     void ParseParameters(int argc, char* argv[]);
+    void ParseOption(const char* opt);
     void ValidateParameters();
 
     /// Private setters
     void SetNumerics();
+    void SetParameters(const ModelParameters &params);
+    void SetUp(MPI_Comm comm);
+    MPI_Comm SplitEnsemble();
     void SetGridParameters();
-    void SetCartesianGrid();
+    void SetRankMaps();
+    void SetCartesianGrid(MPI_Comm comm);
     void SetNeighbours();
 
     bool verbose;
@@ -100,7 +177,8 @@ private:
     double b;
     double c;
 
-    /// Constants for Burger problem
+    /// Constants for Burger problem: coefficients of the cell (alpha), of the neighbours behind
+    /// (beta_sum) and ahead (beta_2); the non-linear part bdx*U, bdy*V is upwinded per cell
     double bdx;
     double bdy;
 
@@ -110,10 +188,57 @@ private:
     double beta_dx_sum;
     double alpha_sum;
 
+    /// Same constants per unit time, scaled by dt in SetTimeStep()
+    double bdx_rate;
+    double bdy_rate;
+    double beta_dx_2_rate;
+    double beta_dy_2_rate;
+    double beta_dx_sum_rate;
+    double beta_dy_sum_rate;
+    double alpha_sum_rate;
+
+    /// ADI: diffusion numbers c*dt/(2dx^2), c*dt/(2dy^2) of the half-steps, and their rates
+    double rx;
+    double ry;
+    double diff_x_rate;
+    double diff_y_rate;
+
 
     // Add any additional parameters here...
 
-    /// MPI Parameters
+    /// Run-time options
+    double cfl;
+    Scheme scheme;
+    HaloMode haloMode;
+    EnergyMode energyMode;
+    Layout layout;
+    Profile profile;
+    Boundary boundary;
+    Stencil stencil;
+    bool hugePages;
+
+    /// Stretched grid (--stretch=s, 0 for uniform): node positions and per-column, per-row
+    /// coefficients along x and y, replacing dx, dy and the scalar constants in the sweep.
+    /// Needs an adaptive time step (--cfl): the fixed dt is only stable on the uniform grid
+    double stretch;
+    GridMetric metricX;
+    GridMetric metricY;
+
+    /// Refined patches where the divided gradient of U or V exceeds amr (--amr=threshold, 0 for
+    /// none), see PatchHierarchy
+    double amr;
+
+    /// Steps between repartitions of the sub-matrices by measured work (0: fixed even split)
+    int rebalance;
+
+    /// Ensemble mode: file of (ax, ay, b, c) cases, run by groups of Px*Py ranks side by side;
+    /// the process grid of this rank spans its group
+    std::string ensembleFile;
+    int group;
+    int groups;
+
+    /// MPI Parameters; MPI is initialised and finalised by Model only when built from the command line
+    bool ownsMPI;
     int p;
     int loc_rank;
     int Px;
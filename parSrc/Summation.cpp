@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Summation.h"
+
+/// Lane accumulators per block and elements per block
+static const int LANES = 8;
+static const int BLOCK = 1024;
+
+/**
+ * @brief Sum of squares with a given row stride; inlined so a unit stride is a compile-time constant
+ * @tparam WEIGHTED weight row k by wy[k] within the lanes and column i by wx[i] per block
+ * */
+template <bool WEIGHTED>
+static inline double StridedSumOfSquares(const double* x, const double* y, const double* wx, const double* wy,
+                                         int rows, int cols, int ld, int inc) {
+    double sum = 0.0;
+    double comp = 0.0;
+    for (int i = 0; i < cols; i++) {
+        const double* xi = x + i*ld;
+        const double* yi = y + i*ld;
+        for (int start = 0; start < rows; start += BLOCK) {
+            int end = (start + BLOCK < rows) ? start + BLOCK : rows;
+
+            /// Independent lanes over the block
+            double lane[LANES] = {0.0};
+            int k = start;
+            for (; k + LANES <= end; k += LANES) {
+                for (int l = 0; l < LANES; l++) {
+                    int kl = (k+l)*inc;
+                    double sq = xi[kl]*xi[kl] + yi[kl]*yi[kl];
+                    lane[l] += WEIGHTED ? wy[k+l]*sq : sq;
+                }
+            }
+            double block = 0.0;
+            for (; k < end; k++) {
+                double sq = xi[k*inc]*xi[k*inc] + yi[k*inc]*yi[k*inc];
+                block += WEIGHTED ? wy[k]*sq : sq;
+            }
+
+            /// Pairwise reduction of lanes
+            for (int w = LANES/2; w > 0; w /= 2) {
+                for (int l = 0; l < w; l++) {
+                    lane[l] += lane[l+w];
+                }
+            }
+            block += lane[0];
+            if (WEIGHTED) block *= wx[i];
+
+            /// Neumaier compensated accumulation of block sums
+            double t = sum + block;
+            if (fabs(sum) >= fabs(block)) comp += (sum - t) + block;
+            else comp += (block - t) + sum;
+            sum = t;
+        }
+    }
+    return sum + comp;
+}
+
+double SumOfSquares(const double* x, const double* y, int rows, int cols, int ld, int inc) {
+    if (inc == 1) return StridedSumOfSquares<false>(x, y, nullptr, nullptr, rows, cols, ld, 1);
+    return StridedSumOfSquares<false>(x, y, nullptr, nullptr, rows, cols, ld, inc);
+}
+
+double SumOfSquares(const double* x, const double* y, const double* wx, const double* wy,
+                    int rows, int cols, int ld, int inc) {
+    if (inc == 1) return StridedSumOfSquares<true>(x, y, wx, wy, rows, cols, ld, 1);
+    return StridedSumOfSquares<true>(x, y, wx, wy, rows, cols, ld, inc);
+}
+
+/// Additions between carry propagations; keeps every limb below 2^62 in magnitude
+static const int MAX_PENDING = 1 << 30;
+static const long long RADIX = 1LL << 32;
+
+/**
+ * @brief Constructor: zero sum
+ * */
+ExactSum::ExactSum() {
+    for (int k = 0; k < LIMBS; k++) limb[k] = 0;
+    pending = 0;
+}
+
+/**
+ * @brief Adds x exactly. Non-finite values are ignored
+ * */
+void ExactSum::Add(double x) {
+    if (x == 0.0 || !std::isfinite(x)) return;
+
+    /// Split into integer mantissa and bit position of its lowest bit (2^-1074 is position 0)
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bool negative = (bits >> 63) != 0;
+    int expo = static_cast<int>((bits >> 52) & 0x7FF);
+    uint64_t m = bits & ((1ULL << 52) - 1);
+    int pos = 0;
+    if (expo > 0) {
+        m |= 1ULL << 52;
+        pos = expo - 1;
+    }
+
+    /// Spread the 53-bit mantissa over three 32-bit limbs
+    int L = pos / 32;
+    int shift = pos % 32;
+    uint64_t rest = (shift == 0) ? (m >> 32) : (m >> (32 - shift));
+    long long part[3] = {
+        static_cast<long long>((m << shift) & 0xFFFFFFFFULL),
+        static_cast<long long>(rest & 0xFFFFFFFFULL),
+        static_cast<long long>(rest >> 32)
+    };
+    for (int k = 0; k < 3; k++) {
+        limb[L+k] += negative ? -part[k] : part[k];
+    }
+
+    if (++pending == MAX_PENDING) Normalise();
+}
+
+/**
+ * @brief Propagates carries so every limb but the top one lies in [0, 2^32)
+ * The normalised limbs are a unique representation of the sum
+ * */
+void ExactSum::Normalise() {
+    long long carry = 0;
+    for (int k = 0; k < LIMBS-1; k++) {
+        long long v = limb[k] + carry;
+        carry = (v >= 0) ? v / RADIX : -((-v - 1) / RADIX) - 1;
+        limb[k] = v - carry * RADIX;
+    }
+    limb[LIMBS-1] += carry;
+    pending = 0;
+}
+
+/**
+ * @brief Rounds the sum to a double from its three most significant limbs
+ * IMPORTANT: Run Normalise() first
+ * */
+double ExactSum::Value() const {
+    int top = LIMBS-1;
+    while (top > 0 && limb[top] == 0) top--;
+    double value = 0.0;
+    for (int k = top; k >= 0 && k > top-3; k--) {
+        value += ldexp(static_cast<double>(limb[k]), 32*k - 1074);
+    }
+    return value;
+}
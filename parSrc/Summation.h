@@ -0,0 +1,47 @@
+#ifndef SUMMATION_H
+#define SUMMATION_H
+
+/**
+ * @brief Fused, compensated sum of squares of two column-major arrays: sum(x^2 + y^2)
+ * Column blocks are reduced with independent lane accumulators (vectorisable) combined pairwise,
+ * and block sums are accumulated with Neumaier compensation
+ * @param x first array
+ * @param y second array
+ * @param rows number of rows
+ * @param cols number of columns
+ * @param ld distance between consecutive columns
+ * @param inc distance between consecutive rows (2 for interleaved (U,V) cells)
+ * */
+double SumOfSquares(const double* x, const double* y, int rows, int cols, int ld, int inc);
+
+/**
+ * @brief Weighted sum of squares: sum(wx[i]*wy[j]*(x^2 + y^2)) over column i and row j,
+ * reduced as above with the row weights inside the lanes and the column weight per block
+ * @param wx weight of every column
+ * @param wy weight of every row
+ * */
+double SumOfSquares(const double* x, const double* y, const double* wx, const double* wy,
+                    int rows, int cols, int ld, int inc);
+
+/**
+ * @class ExactSum
+ * @brief Exact accumulator for doubles: the sum is held as a fixed-point integer split into
+ * 32-bit limbs covering the whole double range, so it does not depend on the order of additions.
+ * Limbs of several accumulators can be added element-wise (e.g. MPI_SUM on MPI_LONG_LONG)
+ * */
+class ExactSum {
+public:
+    static const int LIMBS = 67;
+
+    ExactSum();
+
+    void Add(double x);
+    void Normalise();
+    double Value() const;
+    long long* Limbs() { return limb; }
+private:
+    long long limb[LIMBS];
+    int pending;
+};
+
+#endif //SUMMATION_H
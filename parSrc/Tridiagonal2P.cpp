@@ -0,0 +1,265 @@
+#include <mpi.h>
+#include "Tridiagonal2P.h"
+
+/// Lines swept together: enough independent recurrences to hide latency, few enough streams
+static const int LINE_BLOCK = 32;
+
+/**
+ * @brief Constructor: allocates operators for local segments of n cells
+ * @param n number of local cells per line (at least 2)
+ * @param cart cartesian communicator
+ * @param dim direction of the lines in cart
+ * */
+Tridiagonal2P::Tridiagonal2P(int n, MPI_Comm cart, int dim) : n(n), r(0.0) {
+    int remain[2] = {0, 0};
+    remain[dim] = 1;
+    MPI_Cart_sub(cart, remain, &lineComm);
+    MPI_Comm_size(lineComm, &P);
+    MPI_Comm_rank(lineComm, &coord);
+
+    pivot = new double[n];
+    upper = new double[n];
+    fullPivot = new double[n];
+    fullUpper = new double[n];
+    alpha = new double[n];
+    beta = new double[n];
+    redSub = new double[2*P];
+    redPivot = new double[2*P];
+    redUpper = new double[2*P];
+    sendBuf = nullptr;
+    recvBuf = nullptr;
+    bufLines = 0;
+}
+
+/**
+ * @brief Destructor: Deletes all allocated pointers and the line communicator
+ * */
+Tridiagonal2P::~Tridiagonal2P() {
+    delete[] pivot;
+    delete[] upper;
+    delete[] fullPivot;
+    delete[] fullUpper;
+    delete[] alpha;
+    delete[] beta;
+    delete[] redSub;
+    delete[] redPivot;
+    delete[] redUpper;
+    delete[] sendBuf;
+    delete[] recvBuf;
+    MPI_Comm_free(&lineComm);
+}
+
+/**
+ * @brief Factors I - rD: the whole local line, its interior rows and the reduced system.
+ * Collective over the line communicator
+ * @param r diffusion number of the half-step, c*dt/(2*h^2)
+ * */
+void Tridiagonal2P::Factor(double r) {
+    this->r = r;
+
+    /// Whole local line, used when it is not split over ranks
+    double b = 1.0 + 2.0*r;
+    fullPivot[0] = 1.0 / b;
+    fullUpper[0] = -r * fullPivot[0];
+    for (int k = 1; k < n; k++) {
+        fullPivot[k] = 1.0 / (b + r*fullUpper[k-1]);
+        fullUpper[k] = -r * fullPivot[k];
+    }
+
+    /// Interior rows 1..n-2, decoupled from the first and last cell
+    for (int k = 1; k < n-1; k++) {
+        pivot[k] = 1.0 / ((k == 1) ? b : b + r*upper[k-1]);
+        upper[k] = -r * pivot[k];
+    }
+
+    /// alpha, beta: interior response to the first/last cell, which enter rows 1 and n-2 as +r
+    for (int k = 0; k < n; k++) {
+        alpha[k] = 0.0;
+        beta[k] = 0.0;
+    }
+    alpha[0] = 1.0;
+    beta[n-1] = 1.0;
+    if (n > 2) {
+        alpha[1] += r;
+        beta[n-2] += r;
+        for (int k = 1; k < n-1; k++) {
+            double prevA = (k > 1) ? alpha[k-1] : 0.0;
+            double prevB = (k > 1) ? beta[k-1] : 0.0;
+            alpha[k] = (alpha[k] + r*prevA) * pivot[k];
+            beta[k] = (beta[k] + r*prevB) * pivot[k];
+        }
+        for (int k = n-3; k >= 1; k--) {
+            alpha[k] -= upper[k] * alpha[k+1];
+            beta[k] -= upper[k] * beta[k+1];
+        }
+    }
+
+    /// Our two reduced rows (sub, diagonal, super): first cell, then last cell
+    double rows[6] = {(coord > 0) ? -r : 0.0, b - r*alpha[1], -r*beta[1],
+                      -r*alpha[n-2], b - r*beta[n-2], (coord < P-1) ? -r : 0.0};
+    double* all = new double[6*P];
+    MPI_Allgather(rows, 6, MPI_DOUBLE, all, 6, MPI_DOUBLE, lineComm);
+
+    /// Factor the reduced system of the whole line
+    for (int k = 0; k < 2*P; k++) {
+        double sub = all[3*k];
+        double diag = all[3*k+1];
+        double sup = all[3*k+2];
+        redSub[k] = sub;
+        redPivot[k] = 1.0 / ((k == 0) ? diag : diag - sub*redUpper[k-1]);
+        redUpper[k] = sup * redPivot[k];
+    }
+    delete[] all;
+}
+
+/**
+ * @brief y = (I + rD) x for every line, swept cell by cell across a block of lines
+ * The cells just outside each segment (halo values or zero boundary) enter the end equations
+ * @param x input lines
+ * @param y output lines, same layout as x
+ * @param inc distance between consecutive cells of a line
+ * @param nlines number of lines
+ * @param lineStride distance between consecutive lines
+ * */
+void Tridiagonal2P::Apply(const double* x, double* y, int inc, int nlines, int lineStride) const {
+    double rr = r;
+    double d = 1.0 - 2.0*r;
+    for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+        int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+        const double* xb = x + l0*lineStride;
+        double* yb = y + l0*lineStride;
+        for (int k = 0; k < n; k++) {
+            const double* xk = xb + k*inc;
+            double* yk = yb + k*inc;
+            for (int l = 0; l < nb; l++) {
+                yk[l*lineStride] = d*xk[l*lineStride] + rr*(xk[l*lineStride - inc] + xk[l*lineStride + inc]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief x = (I - rD)^-1 x for every line, in place. Collective over the line communicator
+ * Sweeps cell by cell across all lines, so lines that are adjacent in memory vectorise
+ * @param x lines, overwritten with the solution
+ * @param inc distance between consecutive cells of a line
+ * @param nlines number of lines
+ * @param lineStride distance between consecutive lines
+ * */
+void Tridiagonal2P::Solve(double* x, int inc, int nlines, int lineStride) {
+    if (bufLines < nlines) {
+        delete[] sendBuf;
+        delete[] recvBuf;
+        bufLines = nlines;
+        sendBuf = new double[2*nlines];
+        recvBuf = new double[2*P*nlines];
+    }
+
+    double rr = r;
+
+    /// Whole line on this rank: plain Thomas sweep, a block of lines at a time
+    if (P == 1) {
+        for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+            int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+            double* xb = x + l0*lineStride;
+            double p0 = fullPivot[0];
+            for (int l = 0; l < nb; l++) {
+                xb[l*lineStride] *= p0;
+            }
+            for (int k = 1; k < n; k++) {
+                double* xk = xb + k*inc;
+                double pk = fullPivot[k];
+                for (int l = 0; l < nb; l++) {
+                    xk[l*lineStride] = (xk[l*lineStride] + rr*xk[l*lineStride - inc]) * pk;
+                }
+            }
+            for (int k = n-2; k >= 0; k--) {
+                double* xk = xb + k*inc;
+                double uk = fullUpper[k];
+                for (int l = 0; l < nb; l++) {
+                    xk[l*lineStride] -= uk * xk[l*lineStride + inc];
+                }
+            }
+        }
+        return;
+    }
+
+    /// Interior rows with the first and last cell set to zero, a block of lines at a time
+    if (n > 2) {
+        for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+            int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+            double* xb = x + l0*lineStride;
+            double p1 = pivot[1];
+            for (int l = 0; l < nb; l++) {
+                xb[l*lineStride + inc] *= p1;
+            }
+            for (int k = 2; k < n-1; k++) {
+                double* xk = xb + k*inc;
+                double pk = pivot[k];
+                for (int l = 0; l < nb; l++) {
+                    xk[l*lineStride] = (xk[l*lineStride] + rr*xk[l*lineStride - inc]) * pk;
+                }
+            }
+            for (int k = n-3; k >= 1; k--) {
+                double* xk = xb + k*inc;
+                double uk = upper[k];
+                for (int l = 0; l < nb; l++) {
+                    xk[l*lineStride] -= uk * xk[l*lineStride + inc];
+                }
+            }
+        }
+    }
+
+    /// Reduced right-hand sides: first and last rows with the interior solution substituted
+    double* last = x + (n-1)*inc;
+    for (int l = 0; l < nlines; l++) {
+        double y1 = (n > 2) ? x[l*lineStride + inc] : 0.0;
+        double y2 = (n > 2) ? last[l*lineStride - inc] : 0.0;
+        sendBuf[2*l] = x[l*lineStride] + rr*y1;
+        sendBuf[2*l+1] = last[l*lineStride] + rr*y2;
+    }
+    MPI_Allgather(sendBuf, 2*nlines, MPI_DOUBLE, recvBuf, 2*nlines, MPI_DOUBLE, lineComm);
+
+    /// Reduced systems of all lines; row k of line l is recvBuf[(k/2)*2*nlines + 2*l + k%2]
+    double* w = recvBuf;
+    for (int l = 0; l < nlines; l++) {
+        w[2*l] *= redPivot[0];
+    }
+    for (int k = 1; k < 2*P; k++) {
+        double* wk = w + (k/2)*2*nlines + k%2;
+        const double* wp = w + ((k-1)/2)*2*nlines + (k-1)%2;
+        double sk = redSub[k];
+        double pk = redPivot[k];
+        for (int l = 0; l < nlines; l++) {
+            wk[2*l] = (wk[2*l] - sk*wp[2*l]) * pk;
+        }
+    }
+    for (int k = 2*P-2; k >= 0; k--) {
+        double* wk = w + (k/2)*2*nlines + k%2;
+        const double* wn = w + ((k+1)/2)*2*nlines + (k+1)%2;
+        double uk = redUpper[k];
+        for (int l = 0; l < nlines; l++) {
+            wk[2*l] -= uk * wn[2*l];
+        }
+    }
+
+    /// Our first and last cells, and the interior from its response to them
+    const double* own = recvBuf + coord*2*nlines;
+    for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+        int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+        double* xb = x + l0*lineStride;
+        const double* ob = own + 2*l0;
+        for (int l = 0; l < nb; l++) {
+            xb[l*lineStride] = ob[2*l];
+            xb[l*lineStride + (n-1)*inc] = ob[2*l+1];
+        }
+        for (int k = 1; k < n-1; k++) {
+            double* xk = xb + k*inc;
+            double a = alpha[k];
+            double bt = beta[k];
+            for (int l = 0; l < nb; l++) {
+                xk[l*lineStride] += a*ob[2*l] + bt*ob[2*l+1];
+            }
+        }
+    }
+}
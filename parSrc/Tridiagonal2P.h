@@ -0,0 +1,52 @@
+#ifndef CLASS_TRIDIAGONAL2P
+#define CLASS_TRIDIAGONAL2P
+
+#include <mpi.h>
+
+/**
+ * @class Tridiagonal2P
+ * @brief Half-steps of the ADI diffusion along one direction of the cartesian grid,
+ * I + rD and (I - rD)^-1, where D is the second difference [1 -2 1] with zero Dirichlet ends.
+ * Each line is split over the ranks of that direction. Solves use substructuring: every rank
+ * writes its interior cells in terms of its own first and last cell, and those 2P unknowns
+ * per line form a tridiagonal reduced system, gathered along the line and solved on every rank.
+ * A line held by a single rank is solved directly.
+ * Lines are handled in batches: element k of line l is x[l*lineStride + k*inc]
+ * */
+class Tridiagonal2P {
+public:
+    Tridiagonal2P(int n, MPI_Comm cart, int dim);
+    ~Tridiagonal2P();
+
+    void Factor(double r);
+    void Apply(const double* x, double* y, int inc, int nlines, int lineStride) const;
+    void Solve(double* x, int inc, int nlines, int lineStride);
+private:
+    /// Local cells per line (at least 2), line communicator, its size and our position in it
+    int n;
+    MPI_Comm lineComm;
+    int P;
+    int coord;
+    double r;
+
+    /// Thomas factors of I - rD over the whole local line, and over its interior rows 1..n-2
+    double* fullPivot;
+    double* fullUpper;
+    double* pivot;
+    double* upper;
+
+    /// Response of the local cells to a unit first cell (alpha) and a unit last cell (beta)
+    double* alpha;
+    double* beta;
+
+    /// Factors of the reduced system, unknowns (first, last) of every rank in order
+    double* redSub;
+    double* redPivot;
+    double* redUpper;
+
+    /// Reduced right-hand sides: ours, and those of the whole line
+    double* sendBuf;
+    double* recvBuf;
+    int bufLines;
+};
+#endif //CLASS_TRIDIAGONAL2P
@@ -1,14 +1,69 @@
 #include <chrono>
 #include "Model2P.h"
 #include "Burgers2P.h"
+#include "Ensemble.h"
 #include <iostream>
 
+typedef std::chrono::high_resolution_clock hrc;
+typedef std::chrono::milliseconds ms;
+typedef std::chrono::duration<double> fsec;
+
+/**
+ * @brief Runs the cases of the ensemble file on the rank groups and writes ensemble.txt
+ * Group g runs cases g, g + groups, ... on one solver; the results are gathered on world rank 0
+ * */
+static int RunEnsemble(Model &m) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    EnsembleCase* cases;
+    int n = ReadEnsemble(m.GetEnsembleFile(), cases);
+    if (n < 0) {
+        if (rank == 0) std::cout << "ERROR: Cannot read ensemble file " << m.GetEnsembleFile() << std::endl;
+        return 1;
+    }
+    if (rank == 0) {
+        m.PrintParameters();
+        std::cout << "Ensemble: " << n << " cases" << std::endl;
+    }
+
+    hrc::time_point start = hrc::now();
+    {
+        Burgers2P b(m);
+        RunCases(b, m, cases, n, m.GetEnsembleGroup(), m.GetEnsembleGroups());
+    }
+    hrc::time_point end = hrc::now();
+
+    /// Each case is owned by the root of one group; the others contribute zeros to the sums
+    double* E = new double[n]();
+    int* steps = new int[n]();
+    if (m.GetRank() == 0) {
+        for (int i = m.GetEnsembleGroup(); i < n; i += m.GetEnsembleGroups()) {
+            E[i] = cases[i].E;
+            steps[i] = cases[i].steps;
+        }
+    }
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : E, E, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : steps, steps, n, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        for (int i = 0; i < n; ++i) {
+            cases[i].E = E[i];
+            cases[i].steps = steps[i];
+        }
+        fsec elapsed_seconds = end-start;
+        std::cout << "Time elapsed: " << elapsed_seconds.count() << " s" << std::endl;
+        WriteEnsemble("ensemble.txt", cases, n);
+    }
+    delete[] E;
+    delete[] steps;
+    delete[] cases;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     Model m(argc, argv);
-
-    typedef std::chrono::high_resolution_clock hrc;
-    typedef std::chrono::milliseconds ms;
-    typedef std::chrono::duration<double> fsec;
+    if (m.IsEnsemble()) return RunEnsemble(m);
 
     Burgers2P b(m);
     // Call code to initialise the problem here;
@@ -25,6 +80,8 @@ int main(int argc, char* argv[]) {
     ms elapsed_ms = std::chrono::duration_cast<ms>(elapsed_seconds);
     std::cout << "Time elapsed: " << elapsed_seconds.count() << " s" << std::endl;
     std::cout << "Time elapsed: " << elapsed_ms.count() << " ms" << std::endl;
+    std::cout << "Time steps: " << b.GetSteps() << std::endl;
+    if (m.IsImplicit()) std::cout << "Solver iterations: " << b.GetSolverIterations() << std::endl;
 
     // Calculate final energy and write output
     b.SetEnergy();
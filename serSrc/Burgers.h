@@ -1,32 +1,14 @@
 #ifndef CLASS_BURGERS
 #define CLASS_BURGERS
 
-#include "Model.h"
+#include "SerialDecomposition.h"
+#include "BurgersCore.h"
 
 /**
- * @class Burgers
- * @brief Creates a Burgers instance that does computations on Burger's equation
+ * @brief Burgers solver over the whole grid in one domain
+ * The core is instantiated once, in Burgers.cpp
  * */
-class Burgers {
-public:
-    Burgers(Model &m);
-    ~Burgers();
+typedef BurgersCore<SerialDecomposition> Burgers;
+extern template class BurgersCore<SerialDecomposition>;
 
-    void SetInitialVelocity();
-    void SetIntegratedVelocity();
-    void WriteVelocityFile();
-    void SetEnergy();
-    double GetE()     const { return E; }
-private:
-    void ComputeNextVelocityState();
-    void wrap(double* A, int Nyr, int Nxr, double** res);
-
-    /// Burger parameters
-    Model* model;
-    double* U;
-    double* V;
-    double* NextU;
-    double* NextV;
-    double E;
-};
 #endif //CLASS_BURGERS
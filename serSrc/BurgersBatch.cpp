@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include "BLAS_Wrapper.h"
+#include "InitialCondition.h"
+#include "BurgersBatch.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: allocates U, V, NextU, NextV for W cases per cell, all cases cleared
+ * @param &m reference to Model instance, whose grid and time step the cases share
+ * */
+template <int W>
+BurgersBatch<W>::BurgersBatch(Model &m) : model(&m) {
+    Nyr = model->GetNy() - 2;
+    Nxr = model->GetNx() - 2;
+    storage = new FieldStorage(Nyr, Nxr, 4, W, 1, model->UseHugePages());
+    ld = storage->GetLd();
+    U = storage->Field(0);
+    V = storage->Field(1);
+    NextU = storage->Field(2);
+    NextV = storage->Field(3);
+    reg = 0;
+    for (int k = 0; k < W; k++) {
+        ClearCase(k);
+        E[k] = 0.0;
+    }
+    steps = 0;
+    activeX0 = activeX1 = activeY0 = activeY1 = 0;
+}
+
+/**
+ * @brief Destructor: frees the fields
+ * */
+template <int W>
+BurgersBatch<W>::~BurgersBatch() {
+    delete storage;
+}
+
+/**
+ * @brief Sets the physics of case k, through the Model's numerics
+ * @return false, with case k cleared, if c is negative
+ * */
+template <int W>
+bool BurgersBatch<W>::SetCase(int k, double ax, double ay, double b, double c) {
+    if (!model->SetPhysics(ax, ay, b, c)) {
+        ClearCase(k);
+        return false;
+    }
+    alpha_sum[k] = model->GetAlpha_Sum();
+    beta_dx_sum[k] = model->GetBetaDx_Sum();
+    beta_dy_sum[k] = model->GetBetaDy_Sum();
+    beta_dx_2[k] = model->GetBetaDx_2();
+    beta_dy_2[k] = model->GetBetaDy_2();
+    bdx[k] = model->GetBDx();
+    bdy[k] = model->GetBDy();
+    return true;
+}
+
+/**
+ * @brief Leaves case k idle: with zero constants its fields keep the initial profile
+ * */
+template <int W>
+void BurgersBatch<W>::ClearCase(int k) {
+    alpha_sum[k] = 0.0;
+    beta_dx_sum[k] = 0.0;
+    beta_dy_sum[k] = 0.0;
+    beta_dx_2[k] = 0.0;
+    beta_dy_2[k] = 0.0;
+    bdx[k] = 0.0;
+    bdy[k] = 0.0;
+}
+
+/**
+ * @brief Sets the initial velocity of every case from the selected profile
+ * */
+template <int W>
+void BurgersBatch<W>::SetInitialVelocity() {
+    storage->Clear();
+    switch (model->GetProfile()) {
+        case Profile::Gaussian:
+            SetProfile(GaussianProfile());
+            break;
+        default:
+            SetProfile(BumpProfile());
+            break;
+    }
+    steps = 0;
+}
+
+/**
+ * @brief Fills every case of U, V with a profile, inside the profile's box only (see FillProfile)
+ * */
+template <int W>
+template <class P>
+void BurgersBatch<W>::SetProfile(const P &p) {
+    double x0 = model->GetX0();
+    double y0 = model->GetY0();
+    double dx = model->GetDx();
+    double dy = model->GetDy();
+
+    int i0, i1, j0, j1;
+    ClipToBox(P::XMIN, P::XMAX, x0 + dx, dx, Nxr, i0, i1);
+    ClipToBox(-P::YMAX, -P::YMIN, dy - y0, dy, Nyr, j0, j1);
+
+    for (int i = i0; i < i1; i++) {
+        double x = x0 + (i+1)*dx;
+        for (int j = j0; j < j1; j++) {
+            double f = p(x, y0 - (j+1)*dy);
+            double* u = U + W*(i*ld + j);
+            double* v = V + W*(i*ld + j);
+            for (int k = 0; k < W; k++) {
+                u[k] = f;
+                v[k] = f;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Integrates every case from the initial velocity up to T: Nt-1 steps of dt
+ * U, V are fields 2*reg, 2*reg+1 of the arena; periodic ghosts are wrapped before every step
+ * */
+template <int W>
+void BurgersBatch<W>::SetIntegratedVelocity() {
+    SetActiveRegion();
+    for (steps = 0; steps < model->GetNt() - 1; steps++) {
+        if (model->IsPeriodic()) {
+            storage->Wrap(2*reg);
+            storage->Wrap(2*reg + 1);
+        }
+        GrowActiveRegion();
+        ComputeNextVelocityState();
+        swap(U, NextU);
+        swap(V, NextV);
+        reg = 1 - reg;
+    }
+}
+
+/**
+ * @brief Sets the active region to the bounding box of the non-zero cells of U, V, or to the
+ * whole domain with periodic boundaries, where the region wraps around the edges
+ * */
+template <int W>
+void BurgersBatch<W>::SetActiveRegion() {
+    if (model->IsPeriodic()) {
+        activeX0 = 0;
+        activeY0 = 0;
+        activeX1 = Nxr;
+        activeY1 = Nyr;
+        return;
+    }
+    activeX0 = Nxr;
+    activeY0 = Nyr;
+    activeX1 = 0;
+    activeY1 = 0;
+    for (int i = 0; i < Nxr; i++) {
+        for (int j = 0; j < Nyr; j++) {
+            int curr = W*(i*ld + j);
+            bool nonzero = false;
+            for (int k = 0; k < W; k++) nonzero |= (U[curr+k] != 0.0 || V[curr+k] != 0.0);
+            if (nonzero) {
+                activeX0 = min(activeX0, i);
+                activeY0 = min(activeY0, j);
+                activeX1 = max(activeX1, i + 1);
+                activeY1 = max(activeY1, j + 1);
+            }
+        }
+    }
+    if (activeX0 >= activeX1) activeX0 = activeX1 = activeY0 = activeY1 = 0;
+}
+
+/**
+ * @brief Widens the active region by the one-cell reach of the stencil, within the domain
+ * */
+template <int W>
+void BurgersBatch<W>::GrowActiveRegion() {
+    if (activeX0 >= activeX1) return;
+    activeX0 = max(activeX0 - 1, 0);
+    activeX1 = min(activeX1 + 1, Nxr);
+    activeY0 = max(activeY0 - 1, 0);
+    activeY1 = min(activeY1 + 1, Nyr);
+}
+
+/**
+ * @brief Computes one Euler step of every case over the active region, into NextU, NextV
+ * The update of a case is that of BurgersCore, term by term; the W cases of a cell are
+ * contiguous and the constants are copied to the stack, so the case loop is one vector
+ * operation per term
+ * */
+template <int W>
+void BurgersBatch<W>::ComputeNextVelocityState() {
+    double a_sum[W], bx_sum[W], by_sum[W], bx_2[W], by_2[W], bx[W], by[W];
+    for (int k = 0; k < W; k++) {
+        a_sum[k] = alpha_sum[k];
+        bx_sum[k] = beta_dx_sum[k];
+        by_sum[k] = beta_dy_sum[k];
+        bx_2[k] = beta_dx_2[k];
+        by_2[k] = beta_dy_2[k];
+        bx[k] = bdx[k];
+        by[k] = bdy[k];
+    }
+    int col = W*ld;
+
+    for (int i = activeX0; i < activeX1; i++) {
+        /// Column i, and columns i-1 and i+1, of every field
+        const double* inU = U + i*col;
+        const double* inV = V + i*col;
+        const double* inUL = inU - col;
+        const double* inVL = inV - col;
+        const double* inUR = inU + col;
+        const double* inVR = inV + col;
+        double* outU = NextU + i*col;
+        double* outV = NextV + i*col;
+        for (int j = activeY0; j < activeY1; j++) {
+            const double* u = inU + W*j;
+            const double* v = inV + W*j;
+            const double* uL = inUL + W*j;
+            const double* vL = inVL + W*j;
+            const double* uR = inUR + W*j;
+            const double* vR = inVR + W*j;
+            double nu[W], nv[W];
+            for (int k = 0; k < W; k++) {
+                double bdxU = bx[k] * u[k];
+                double bdyV = by[k] * v[k];
+
+                double alpha_total = a_sum[k] - fabs(bdxU) - fabs(bdyV);
+                double bdxU_total = max(bdxU, 0.0) + bx_sum[k];
+                double bdyV_total = max(bdyV, 0.0) + by_sum[k];
+                double fdxU_total = bx_2[k] - min(bdxU, 0.0);
+                double fdyV_total = by_2[k] - min(bdyV, 0.0);
+                double nextU = alpha_total * u[k];
+                double nextV = alpha_total * v[k];
+                nextU += fdxU_total * uR[k];
+                nextV += fdxU_total * vR[k];
+                nextU += bdxU_total * uL[k];
+                nextV += bdxU_total * vL[k];
+                nextU += fdyV_total * u[k+W];
+                nextV += fdyV_total * v[k+W];
+                nextU += bdyV_total * u[k-W];
+                nextV += bdyV_total * v[k-W];
+                nu[k] = nextU + u[k];
+                nv[k] = nextV + v[k];
+            }
+            /* Stored once every case is computed: the stores cannot alias the loads above */
+            for (int k = 0; k < W; k++) {
+                outU[W*j + k] = nu[k];
+                outV[W*j + k] = nv[k];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Calculates and sets the energy of the velocity field of every case
+ * */
+template <int W>
+void BurgersBatch<W>::SetEnergy() {
+    for (int k = 0; k < W; k++) {
+        double ddotU = 0.0;
+        double ddotV = 0.0;
+        for (int i = 0; i < Nxr; i++) {
+            ddotU += F77NAME(ddot)(Nyr, U+W*i*ld+k, W, U+W*i*ld+k, W);
+            ddotV += F77NAME(ddot)(Nyr, V+W*i*ld+k, W, V+W*i*ld+k, W);
+        }
+        E[k] = 0.5 * (ddotU + ddotV) * model->GetDx()*model->GetDy();
+    }
+}
+
+template class BurgersBatch<4>;
+template class BurgersBatch<8>;
@@ -0,0 +1,70 @@
+#ifndef CLASS_BURGERSBATCH
+#define CLASS_BURGERSBATCH
+
+#include "Model.h"
+#include "FieldStorage.h"
+
+/**
+ * @class BurgersBatch
+ * @brief Advances W independent cases of Burger's equation at once, for ensemble sweeps
+ * The cases share the grid, the time step and the initial profile and differ in ax, ay, b, c.
+ * A cell holds the W cases side by side (FieldStorage cells of W doubles), so the innermost
+ * loop runs across the cases with per-case coefficients and vectorises fully, whatever the
+ * grid size. Forward Euler with a fixed time step only; the cases step in lock-step
+ * @tparam W cases per cell (4 or 8), instantiated in BurgersBatch.cpp
+ * */
+template <int W>
+class BurgersBatch {
+public:
+    static constexpr int LANES = W;
+
+    explicit BurgersBatch(Model &m);
+    ~BurgersBatch();
+
+    bool SetCase(int k, double ax, double ay, double b, double c);
+    void ClearCase(int k);
+    void SetInitialVelocity();
+    void SetIntegratedVelocity();
+    void SetEnergy();
+    double GetE(int k) const { return E[k]; }
+    int    GetSteps()  const { return steps; }
+private:
+    template <class P> void SetProfile(const P &p);
+    void SetActiveRegion();
+    void GrowActiveRegion();
+    void ComputeNextVelocityState();
+
+    Model* model;
+    FieldStorage* storage;
+    int Nyr;
+    int Nxr;
+    int ld;
+    double* U;
+    double* V;
+    double* NextU;
+    double* NextV;
+    int reg;
+
+    /// Constants of case k, from Model::SetPhysics; a cleared case has all zero and stays put
+    double alpha_sum[W];
+    double beta_dx_sum[W];
+    double beta_dy_sum[W];
+    double beta_dx_2[W];
+    double beta_dy_2[W];
+    double bdx[W];
+    double bdy[W];
+
+    double E[W];
+    int steps;
+
+    /// Active region, common to the cases as they start from the same profile (see BurgersCore)
+    int activeX0;
+    int activeX1;
+    int activeY0;
+    int activeY1;
+};
+
+extern template class BurgersBatch<4>;
+extern template class BurgersBatch<8>;
+
+#endif //CLASS_BURGERSBATCH
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <cstring>
 #include "Model.h"
 #include "ParseException.h"
 #include <cmath>
@@ -17,6 +19,15 @@ Model::Model(int argc, char** argv) {
     ValidateParameters();
 }
 
+/**
+ * @brief Constructor: sets constants from parameters given in code, for embedding the solver
+ * @param &params problem and run-time options
+ * */
+Model::Model(const ModelParameters &params) {
+    SetParameters(params);
+    ValidateParameters();
+}
+
 /**
  * @brief Destructor: deallocates memory, finalizes MPI program and destroys Model instance
  * */
@@ -26,10 +37,24 @@ Model::~Model() {
 
 /**
  * @brief Parses parameters from command line into program
+ * Positional parameters may be followed by optional --key=value switches
  * @brief Throws an exception if invalid number of arguments are supplied
  * */
 void Model::ParseParameters(int argc, char **argv) {
-    if (argc == 8) {
+    /// Defaults for optional switches
+    cfl = 0.0;
+    scheme = Scheme::Euler;
+    layout = Layout::Split;
+    profile = Profile::Bump;
+    boundary = Boundary::Dirichlet;
+    stencil = Stencil::Upwind;
+    stretch = 0.0;
+    amr = 0.0;
+    hugePages = false;
+    threads = 1;
+    batch = 0;
+
+    if (argc >= 8) {
         ax = atof(argv[1]);
         ay = atof(argv[2]);
         b = atof(argv[3]);
@@ -37,11 +62,114 @@ void Model::ParseParameters(int argc, char **argv) {
         Lx = atof(argv[5]);
         Ly = atof(argv[6]);
         T = atof(argv[7]);
+        for (int k = 8; k < argc; k++) {
+            ParseOption(argv[k]);
+        }
         cout << "Parameters saved successfully." << endl;
     }
     else throw illegalArgumentException;
 }
 
+/**
+ * @brief Parses a single optional --key=value switch
+ * Unknown switches are reported and ignored
+ * @param opt switch as supplied on the command line
+ * */
+void Model::ParseOption(const char* opt) {
+    if (strcmp(opt, "--layout=split") == 0) layout = Layout::Split;
+    else if (strcmp(opt, "--layout=interleaved") == 0) layout = Layout::Interleaved;
+    else if (strcmp(opt, "--init=bump") == 0) profile = Profile::Bump;
+    else if (strcmp(opt, "--init=gaussian") == 0) profile = Profile::Gaussian;
+    else if (strcmp(opt, "--bc=dirichlet") == 0) boundary = Boundary::Dirichlet;
+    else if (strcmp(opt, "--bc=periodic") == 0) boundary = Boundary::Periodic;
+    else if (strcmp(opt, "--stencil=upwind") == 0) stencil = Stencil::Upwind;
+    else if (strcmp(opt, "--stencil=central4") == 0) stencil = Stencil::Central4;
+    else if (strcmp(opt, "--hugepages") == 0) hugePages = true;
+    else if (strcmp(opt, "--scheme=euler") == 0) scheme = Scheme::Euler;
+    else if (strcmp(opt, "--scheme=adi") == 0) scheme = Scheme::ADI;
+    else if (strcmp(opt, "--scheme=rk2") == 0) scheme = Scheme::SSPRK2;
+    else if (strcmp(opt, "--scheme=rk3") == 0) scheme = Scheme::SSPRK3;
+    else if (strcmp(opt, "--scheme=lsrk3") == 0) scheme = Scheme::LSRK3;
+    else if (strcmp(opt, "--scheme=lsrk4") == 0) scheme = Scheme::LSRK4;
+    else if (strcmp(opt, "--scheme=implicit") == 0) scheme = Scheme::Implicit;
+    else if (strcmp(opt, "--scheme=cn") == 0) scheme = Scheme::CrankNicolson;
+    else if (strncmp(opt, "--ensemble=", 11) == 0) ensembleFile = opt + 11;
+    else if (strncmp(opt, "--threads=", 10) == 0) {
+        threads = atoi(opt + 10);
+        if (threads < 1) {
+            cout << "WARN: Threads have to be (>=1), using 1" << endl;
+            threads = 1;
+        }
+    }
+    else if (strncmp(opt, "--batch=", 8) == 0) {
+        batch = atoi(opt + 8);
+        if (batch != 0 && batch != 4 && batch != 8) {
+            cout << "WARN: Batch has to be 4 or 8, running cases one at a time" << endl;
+            batch = 0;
+        }
+    }
+    else if (strncmp(opt, "--stretch=", 10) == 0) {
+        stretch = atof(opt + 10);
+        if (!(stretch >= 0.0)) {
+            cout << "WARN: Stretching has to be (>=0), using a uniform grid" << endl;
+            stretch = 0.0;
+        }
+    }
+    else if (strncmp(opt, "--amr=", 6) == 0) {
+        amr = atof(opt + 6);
+        if (!(amr >= 0.0)) {
+            cout << "WARN: Refinement threshold has to be (>=0), refinement disabled" << endl;
+            amr = 0.0;
+        }
+    }
+    else if (strncmp(opt, "--cfl=", 6) == 0) {
+        cfl = atof(opt + 6);
+        if (!(cfl > 0.0 && cfl <= 1.0)) {
+            cout << "WARN: CFL number has to be in (0,1], using fixed time step" << endl;
+            cfl = 0.0;
+        }
+    }
+    else cout << "WARN: Unknown option " << opt << " ignored" << endl;
+}
+
+/**
+ * @brief Copies the problem and the options from a parameter set
+ * An out-of-range CFL number falls back to the fixed time step, as with --cfl=
+ * @param &params problem and run-time options
+ * */
+void Model::SetParameters(const ModelParameters &params) {
+    ax = params.ax;
+    ay = params.ay;
+    b = params.b;
+    c = params.c;
+    Lx = params.Lx;
+    Ly = params.Ly;
+    T = params.T;
+    cfl = params.cfl;
+    scheme = params.scheme;
+    layout = params.layout;
+    profile = params.profile;
+    boundary = params.boundary;
+    stencil = params.stencil;
+    stretch = params.stretch;
+    amr = params.amr;
+    hugePages = params.hugePages;
+    threads = 1;
+    batch = 0;
+    if (cfl != 0.0 && !(cfl > 0.0 && cfl <= 1.0)) {
+        cout << "WARN: CFL number has to be in (0,1], using fixed time step" << endl;
+        cfl = 0.0;
+    }
+    if (!(stretch >= 0.0)) {
+        cout << "WARN: Stretching has to be (>=0), using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+    if (!(amr >= 0.0)) {
+        cout << "WARN: Refinement threshold has to be (>=0), refinement disabled" << endl;
+        amr = 0.0;
+    }
+}
+
 /**
  * @brief Prints model parameters
  * */
@@ -59,14 +187,47 @@ void Model::PrintParameters() {
  * @brief Checks if parameters supplied are valid
  * */
 bool Model::IsValid() {
-    return ax >= 0 && ay >= 0 && b >= 0 && c >= 0 && Lx >= 0 && Ly >= 0 && T >= 0;
+    return c >= 0 && Lx >= 0 && Ly >= 0 && T >= 0;
 }
 
 /**
  * @brief Validates the parameters. If parameters supplied are valid, set them as instance vars
  * */
 void Model::ValidateParameters() {
-    if (!IsValid()) cout << "WARN: Parameter values have to be (>=0)" << endl;
+    /// Central differences put the advection symbol on the imaginary axis, outside the stability
+    /// region of Euler and SSP-RK2; ADI and the implicit schemes have one-cell operators of their own
+    if (stencil == Stencil::Central4 && (scheme == Scheme::ADI || IsImplicit())) {
+        cout << "WARN: Fourth-order stencils need an explicit scheme, using upwind" << endl;
+        stencil = Stencil::Upwind;
+    }
+    if (stencil == Stencil::Central4 && (scheme == Scheme::Euler || scheme == Scheme::SSPRK2)) {
+        cout << "WARN: Fourth-order stencils need a three-stage Runge-Kutta scheme, using rk3" << endl;
+        scheme = Scheme::SSPRK3;
+    }
+
+    /// The ADI line solver is tridiagonal: no wrap-around lines
+    if (scheme == Scheme::ADI && boundary == Boundary::Periodic) {
+        cout << "WARN: ADI needs Dirichlet boundaries, using Euler" << endl;
+        scheme = Scheme::Euler;
+    }
+    /// The stretched metrics hold the upwind operator of the explicit schemes, between walls
+    if (stretch > 0.0 && (boundary == Boundary::Periodic || scheme == Scheme::ADI || IsImplicit()
+                          || stencil == Stencil::Central4)) {
+        cout << "WARN: Stretched grids need Dirichlet boundaries, the upwind stencil and an explicit scheme, using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+    /// The finest spacing is well below the explicit limit of the fixed dt, set for the uniform grid
+    if (stretch > 0.0 && cfl <= 0.0) {
+        cout << "WARN: Stretched grids need an adaptive time step (--cfl), using a uniform grid" << endl;
+        stretch = 0.0;
+    }
+    /// The patches advance the upwind Euler step of a uniform grid between walls, at a fixed dt
+    if (amr > 0.0 && (scheme != Scheme::Euler || stencil != Stencil::Upwind || stretch > 0.0
+                      || boundary == Boundary::Periodic || cfl > 0.0)) {
+        cout << "WARN: Refinement needs the Euler scheme, the upwind stencil, a uniform grid, Dirichlet boundaries and a fixed time step, disabled" << endl;
+        amr = 0.0;
+    }
+    if (!IsValid()) cout << "WARN: c, Lx, Ly and T have to be (>=0)" << endl;
     else SetNumerics();
 }
 
@@ -78,33 +239,143 @@ void Model::SetNumerics() {
     Ny = 2001;
     Nt = 4001;
     /// dx,dy and dt are dependent on L,T and Nx,Ny,Nt:
-    dx = Lx / (Nx-1);
-    dy = Ly / (Ny-1);
+    /// periodic: the Nx-2 interior columns (Ny-2 rows) span one period, the ghosts repeat them
+    int cellsX = (boundary == Boundary::Periodic) ? Nx-2 : Nx-1;
+    int cellsY = (boundary == Boundary::Periodic) ? Ny-2 : Ny-1;
+    dx = Lx / cellsX;
+    dy = Ly / cellsY;
     dt = T / (Nt-1);
     /// x0 and y0 represent the top LHS of the matrix:
     x0 = -Lx/2.0;
     y0 = Ly/2.0;
+    /// stretched grid: the metrics take over from dx, dy in the sweep, profile and energy
+    if (stretch > 0.0) {
+        metricX.Set(Nx, x0, Lx, 1.0, stretch);
+        metricY.Set(Ny, y0, Ly, -1.0, stretch);
+        metricX.SetCoefficients(ax, b, c);
+        metricY.SetCoefficients(ay, b, c);
+    }
     /// b/dx and b/dy saves computation time in the future
-    bdx = b/dx;
-    bdy = b/dy;
+    bdx_rate = b/dx;
+    bdy_rate = b/dy;
     /// constants used in SetIntegratedVelocity()
     double alpha_dx_2 = (-2.0*c)/pow(dx,2.0);
     double alpha_dy_2 = (-2.0*c)/pow(dy,2.0);
-    double alpha_dx_1 = -ax/dx;
-    double alpha_dy_1 = -ay/dy;
-    double beta_dx_1 = ax/dx;
-    double beta_dy_1 = ay/dy;
-    beta_dx_2 = c/pow(dx,2.0);
-    beta_dy_2 = c/pow(dy,2.0);
-    alpha_sum = alpha_dx_1 + alpha_dx_2 + alpha_dy_1 + alpha_dy_2;
-    beta_dx_sum = beta_dx_1 + beta_dx_2;
-    beta_dy_sum = beta_dy_1 + beta_dy_2;
+    /// linear advection is upwinded once per run: from behind (i-1, j-1) for positive ax, ay,
+    /// from ahead (i+1, j+1) for negative ones
+    double alpha_dx_1 = -fabs(ax)/dx;
+    double alpha_dy_1 = -fabs(ay)/dy;
+    double beta_dx_1 = max(ax, 0.0)/dx;
+    double beta_dy_1 = max(ay, 0.0)/dy;
+    double gamma_dx_1 = max(-ax, 0.0)/dx;
+    double gamma_dy_1 = max(-ay, 0.0)/dy;
+    diff_x_rate = c/pow(dx,2.0);
+    diff_y_rate = c/pow(dy,2.0);
+    beta_dx_2_rate = diff_x_rate + gamma_dx_1;
+    beta_dy_2_rate = diff_y_rate + gamma_dy_1;
+    alpha_sum_rate = alpha_dx_1 + alpha_dx_2 + alpha_dy_1 + alpha_dy_2;
+    beta_dx_sum_rate = beta_dx_1 + diff_x_rate;
+    beta_dy_sum_rate = beta_dy_1 + diff_y_rate;
+    /// ADI: diffusion leaves the explicit update and is solved along x and y lines instead
+    if (scheme == Scheme::ADI) {
+        alpha_sum_rate = alpha_dx_1 + alpha_dy_1;
+        beta_dx_sum_rate = beta_dx_1;
+        beta_dy_sum_rate = beta_dy_1;
+        beta_dx_2_rate = gamma_dx_1;
+        beta_dy_2_rate = gamma_dy_1;
+    }
     /// multiply by dt for pre-computational purposes
-    bdx *= dt;
-    bdy *= dt;
-    alpha_sum *= dt;
-    beta_dx_sum *= dt;
-    beta_dy_sum *= dt;
-    beta_dx_2 *= dt;
-    beta_dy_2 *= dt;
+    SetTimeStep(dt);
+}
+
+/**
+ * @brief Replaces the physical parameters and recomputes the numerics, the time step included
+ * Used to run several cases on one Model (ensemble mode)
+ * @return false, leaving the parameters and numerics unchanged, if c is negative
+ * */
+bool Model::SetPhysics(double ax, double ay, double b, double c) {
+    if (!(c >= 0)) return false;
+    this->ax = ax;
+    this->ay = ay;
+    this->b = b;
+    this->c = c;
+    SetNumerics();
+    return true;
+}
+
+/**
+ * @brief Sets the time step and recomputes every constant that is multiplied by it
+ * @param newDt time step
+ * */
+void Model::SetTimeStep(double newDt) {
+    dt = newDt;
+    bdx = bdx_rate * dt;
+    bdy = bdy_rate * dt;
+    alpha_sum = alpha_sum_rate * dt;
+    beta_dx_sum = beta_dx_sum_rate * dt;
+    beta_dy_sum = beta_dy_sum_rate * dt;
+    beta_dx_2 = beta_dx_2_rate * dt;
+    beta_dy_2 = beta_dy_2_rate * dt;
+    rx = 0.5 * diff_x_rate * dt;
+    ry = 0.5 * diff_y_rate * dt;
+    if (stretch > 0.0) {
+        metricX.Scale(dt);
+        metricY.Scale(dt);
+    }
+}
+
+/**
+ * @brief Largest time step allowed by the CFL number for the given velocity magnitudes
+ * The upwind advection limit (|ax| + |b||U|)/dx + (|ay| + |b||V|)/dy and the diffusion limit
+ * 2c/dx^2 + 2c/dy^2 are combined, which keeps every coefficient of the update non-negative.
+ * With ADI, backward Euler and Crank-Nicolson the diffusion is implicit and only the
+ * advection limit applies. The limit is scaled by the stability radius of the integrator.
+ * Central fourth-order stencils: the advection symbol reaches 1.372 ((|ax| + |b||U|)/dx + (|ay| + |b||V|)/dy)
+ * on the imaginary axis, within ImaginaryBound(), and the diffusion symbol 16c/3 (1/dx^2 + 1/dy^2)
+ * on the negative real axis, within 2R; the two fractions of their bounds add up to the CFL number.
+ * On a stretched grid the smallest spacings stand for dx, dy, which bounds every cell
+ * @param maxU largest |U| over the domain
+ * @param maxV largest |V| over the domain
+ * */
+double Model::StableTimeStep(double maxU, double maxV) const {
+    double dx = IsStretched() ? metricX.GetMinSpacing() : this->dx;
+    double dy = IsStretched() ? metricY.GetMinSpacing() : this->dy;
+    if (stencil == Stencil::Central4) {
+        double adv = 1.372*((fabs(ax) + fabs(b)*maxU)/dx + (fabs(ay) + fabs(b)*maxV)/dy);
+        double dif = 16.0/3.0*c*(1.0/(dx*dx) + 1.0/(dy*dy));
+        double rate = adv/ImaginaryBound() + dif/(2.0*StabilityRadius());
+        return (rate > 0.0) ? cfl/rate : T;
+    }
+    double rate = (fabs(ax) + fabs(b)*maxU)/dx + (fabs(ay) + fabs(b)*maxV)/dy;
+    if (scheme != Scheme::ADI && !IsImplicit()) rate += 2.0*c/(dx*dx) + 2.0*c/(dy*dy);
+    return (rate > 0.0) ? cfl*StabilityRadius()/rate : T;
+}
+
+/**
+ * @brief Radius of the largest disk |z + R| <= R inside the stability region of the explicit
+ * integrator (rounded down). The upwind and diffusion symbols of an Euler-stable step fill the
+ * disk of radius 1, so R is the factor by which a step may exceed the Euler limit
+ * */
+double Model::StabilityRadius() const {
+    switch (scheme) {
+        case Scheme::SSPRK3:
+        case Scheme::LSRK3: return 1.25;
+        case Scheme::LSRK4: return 2.2;
+        default: return 1.0;
+    }
+}
+
+/**
+ * @brief Half-length of the imaginary interval inside the stability region of the explicit
+ * integrator (rounded down), which bounds central advection: sqrt(3) for the three-stage
+ * third-order schemes, 3.34 for the five-stage fourth-order one. Euler and SSP-RK2 have none
+ * (central stencils switch them to SSP-RK3)
+ * */
+double Model::ImaginaryBound() const {
+    switch (scheme) {
+        case Scheme::SSPRK3:
+        case Scheme::LSRK3: return 1.7;
+        case Scheme::LSRK4: return 3.3;
+        default: return 0.0;
+    }
 }
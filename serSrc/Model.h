@@ -1,6 +1,33 @@
 #ifndef CLASS_MODEL
 #define CLASS_MODEL
 
+#include <string>
+#include "GridMetric.h"
+#include "Options.h"
+
+/**
+ * @brief Problem and run-time options of a Model built in code (see Model(const ModelParameters&))
+ * The options default to those of the command line switches
+ * */
+struct ModelParameters {
+    double ax = 0.0;
+    double ay = 0.0;
+    double b = 0.0;
+    double c = 0.0;
+    double Lx = 10.0;
+    double Ly = 10.0;
+    double T = 1.0;
+    double cfl = 0.0;
+    Scheme scheme = Scheme::Euler;
+    Layout layout = Layout::Split;
+    Profile profile = Profile::Bump;
+    Boundary boundary = Boundary::Dirichlet;
+    Stencil stencil = Stencil::Upwind;
+    double stretch = 0.0;
+    double amr = 0.0;
+    bool hugePages = false;
+};
+
 /**
  * @class Model
  * @brief Sets up the model instance specifying key parameters constructing the problem
@@ -8,12 +35,19 @@
 class Model {
 public:
     Model(int argc, char* argv[]);
+    explicit Model(const ModelParameters &params);
     ~Model();
 
     void PrintParameters();
 
     bool IsValid();
 
+    bool SetPhysics(double ax, double ay, double b, double c);
+    void SetTimeStep(double newDt);
+    double StableTimeStep(double maxU, double maxV) const;
+    double StabilityRadius() const;
+    double ImaginaryBound() const;
+
     /// Getters
     bool   IsVerbose() const { return verbose; }
     bool   IsHelp()    const { return help; }
@@ -39,11 +73,38 @@ public:
     double GetBetaDx_Sum() const { return beta_dx_sum; }
     double GetBetaDy_Sum() const { return beta_dy_sum; }
     double GetAlpha_Sum() const { return alpha_sum; }
+    double GetCFL()    const { return cfl; }
+    bool   IsAdaptive() const { return cfl > 0.0; }
+    Scheme GetScheme() const { return scheme; }
+    bool   IsImplicit() const { return scheme == Scheme::Implicit || scheme == Scheme::CrankNicolson; }
+    double GetTheta()  const { return (scheme == Scheme::CrankNicolson) ? 0.5 : 1.0; }
+    double GetRx()     const { return rx; }
+    double GetRy()     const { return ry; }
+    Layout GetLayout() const { return layout; }
+    Profile GetProfile() const { return profile; }
+    Boundary GetBoundary() const { return boundary; }
+    bool   IsPeriodic() const { return boundary == Boundary::Periodic; }
+    Stencil GetStencil() const { return stencil; }
+    int    GetHaloWidth() const { return (stencil == Stencil::Central4) ? 2 : 1; }
+    bool   IsStretched() const { return stretch > 0.0; }
+    double GetStretch() const { return stretch; }
+    bool   IsRefined() const { return amr > 0.0; }
+    double GetAMRThreshold() const { return amr; }
+    const GridMetric& GetMetricX() const { return metricX; }
+    const GridMetric& GetMetricY() const { return metricY; }
+    bool   UseHugePages() const { return hugePages; }
+    bool   IsEnsemble() const { return !ensembleFile.empty(); }
+    const char* GetEnsembleFile() const { return ensembleFile.c_str(); }
+    int    GetThreads() const { return threads; }
+    int    GetBatch()   const { return batch; }
+    bool   CanBatch()   const { return scheme == Scheme::Euler && stencil == Stencil::Upwind && !IsStretched() && !IsRefined() && !IsAdaptive(); }
 
     // Add any other getters here...
 
 private:
     void ParseParameters(int argc, char* argv[]);
+    void ParseOption(const char* opt);
+    void SetParameters(const ModelParameters &params);
     void ValidateParameters();
 
     /// Private Setters
@@ -75,7 +136,8 @@ private:
     double b;
     double c;
 
-    /// Constants for Burger problem
+    /// Constants for Burger problem: coefficients of the cell (alpha), of the neighbours behind
+    /// (beta_sum) and ahead (beta_2); the non-linear part bdx*U, bdy*V is upwinded per cell
     double bdx;
     double bdy;
 
@@ -85,7 +147,48 @@ private:
     double beta_dx_sum;
     double alpha_sum;
 
+    /// Same constants per unit time, scaled by dt in SetTimeStep()
+    double bdx_rate;
+    double bdy_rate;
+    double beta_dx_2_rate;
+    double beta_dy_2_rate;
+    double beta_dx_sum_rate;
+    double beta_dy_sum_rate;
+    double alpha_sum_rate;
+
+    /// ADI: diffusion numbers c*dt/(2dx^2), c*dt/(2dy^2) of the half-steps, and their rates
+    double rx;
+    double ry;
+    double diff_x_rate;
+    double diff_y_rate;
+
     // Add any additional parameters here...
+
+    /// Run-time options
+    double cfl;
+    Scheme scheme;
+    Layout layout;
+    Profile profile;
+    Boundary boundary;
+    Stencil stencil;
+    bool hugePages;
+
+    /// Stretched grid (--stretch=s, 0 for uniform): node positions and per-column, per-row
+    /// coefficients along x and y, replacing dx, dy and the scalar constants in the sweep.
+    /// Needs an adaptive time step (--cfl): the fixed dt is only stable on the uniform grid
+    double stretch;
+    GridMetric metricX;
+    GridMetric metricY;
+
+    /// Refined patches where the divided gradient of U or V exceeds amr (--amr=threshold, 0 for
+    /// none), see PatchHierarchy
+    double amr;
+
+    /// Ensemble mode: file of (ax, ay, b, c) cases, threads running them side by side, and
+    /// cases advanced together by one thread (0: one at a time, see BurgersBatch)
+    std::string ensembleFile;
+    int threads;
+    int batch;
 };
 
 #endif //CLASS_MODEL
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "BLAS_Wrapper.h"
+#include "SerialDecomposition.h"
+#include "VelocityWriter.h"
+
+/**
+ * @brief Constructor: allocates the field arena, a zero ghost frame as wide as the stencil reach
+ * around every field
+ * Split: every register is two fields, U and V. Interleaved: one field of (U,V) cells per register
+ * @param &m reference to Model instance
+ * @param nregisters (U,V) registers of the arena
+ * */
+SerialDecomposition::SerialDecomposition(Model &m, int nregisters) : model(&m) {
+    Nyr = model->GetNy() - 2;
+    Nxr = model->GetNx() - 2;
+    cs = (model->GetLayout() == Layout::Interleaved) ? 2 : 1;
+    ncomp = 2 / cs;
+    periodic = model->IsPeriodic();
+    storage = new FieldStorage(Nyr, Nxr, ncomp*nregisters, cs, model->GetHaloWidth(), model->UseHugePages());
+}
+
+/**
+ * @brief Destructor: frees the field arena
+ * */
+SerialDecomposition::~SerialDecomposition() {
+    delete storage;
+}
+
+/**
+ * @brief Fills the ghost frames of register r from the opposite edges (periodic boundaries)
+ * */
+void SerialDecomposition::Wrap(int r) {
+    for (int c = 0; c < ncomp; c++) storage->Wrap(ncomp*r + c);
+}
+
+/**
+ * @brief Sum of U^2 + V^2 over the grid, one column at a time (columns are padded)
+ * */
+double SerialDecomposition::SumOfSquares(const double* U, const double* V) const {
+    int ld = storage->GetLd();
+    double ddotU = 0.0;
+    double ddotV = 0.0;
+    for (int i = 0; i < Nxr; i++) {
+        ddotU += F77NAME(ddot)(Nyr, U+cs*i*ld, cs, U+cs*i*ld, cs);
+        ddotV += F77NAME(ddot)(Nyr, V+cs*i*ld, cs, V+cs*i*ld, cs);
+    }
+    return ddotU + ddotV;
+}
+
+/**
+ * @brief Sum of wx[i]*wy[j]*(U^2 + V^2) over the grid, one column at a time
+ * @param wx weight of every column
+ * @param wy weight of every row
+ * */
+double SerialDecomposition::SumOfSquares(const double* U, const double* V, const double* wx, const double* wy) const {
+    int ld = storage->GetLd();
+    double sum = 0.0;
+    for (int i = 0; i < Nxr; i++) {
+        double col = 0.0;
+        for (int j = 0; j < Nyr; j++) {
+            int curr = cs*(i*ld + j);
+            col += wy[j] * (U[curr]*U[curr] + V[curr]*V[curr]);
+        }
+        sum += wx[i] * col;
+    }
+    return sum;
+}
+
+/**
+ * @brief Streams U, V into "data.txt", converting column-major fields strip by strip
+ * */
+void SerialDecomposition::WriteVelocityFile(const double* U, const double* V) const {
+    VelocityWriter writer("data.txt");
+    int ld = storage->GetLd();
+    writer.WriteField('U', U, cs, cs*ld, Nyr, Nxr);
+    writer.WriteField('V', V, cs, cs*ld, Nyr, Nxr);
+}
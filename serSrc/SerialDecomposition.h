@@ -0,0 +1,65 @@
+#ifndef CLASS_SERIALDECOMPOSITION
+#define CLASS_SERIALDECOMPOSITION
+
+#include "Model.h"
+#include "FieldStorage.h"
+#include "Tridiagonal.h"
+
+/**
+ * @class SerialDecomposition
+ * @brief Decomposition policy of BurgersCore for a single domain: the whole interior grid in one
+ * field arena whose ghost frames are the boundary: zero, or wrapped around from the opposite
+ * edges by Start() with periodic boundaries. There are no halos, reductions or repartitions,
+ * so those members are empty inline functions and vanish from the core
+ * */
+class SerialDecomposition {
+public:
+    typedef Model ModelType;
+    typedef Tridiagonal Line;
+
+    /// No halos: sweeps run over the domain as one block
+    static constexpr bool OVERLAP = false;
+
+    SerialDecomposition(Model &m, int nregisters);
+    ~SerialDecomposition();
+
+    FieldStorage* GetStorage() const { return storage; }
+    double* GetU(int r) const { return storage->Field(ncomp*r); }
+    double* GetV(int r) const { return (ncomp == 2) ? storage->Field(ncomp*r + 1) : storage->Field(ncomp*r) + 1; }
+    int GetCellSize() const { return cs; }
+    int GetNxr()   const { return Nxr; }
+    int GetNyr()   const { return Nyr; }
+    int GetDisplX() const { return 0; }
+    int GetDisplY() const { return 0; }
+    bool IsRoot()  const { return true; }
+
+    void Start(int r) { if (periodic) Wrap(r); }
+    void Finish() {}
+    void Release() {}
+    void SumAll(double* x, int n) const {}
+    void MaxAll(double* x, int n) const {}
+    void MinAll(int* x, int n) const {}
+    void ExchangeFaces(double* const* send, double* const* recv, const int* count) const {}
+
+    void BeginWork() {}
+    void EndWork() {}
+    int GetRebalanceInterval() const { return 0; }
+    bool Repartition(int r) { return false; }
+
+    Line* NewLineX() const { return new Tridiagonal(Nxr); }
+    Line* NewLineY() const { return new Tridiagonal(Nyr); }
+
+    double SumOfSquares(const double* U, const double* V) const;
+    double SumOfSquares(const double* U, const double* V, const double* wx, const double* wy) const;
+    void Wrap(int r);
+    void WriteVelocityFile(const double* U, const double* V) const;
+private:
+    Model* model;
+    FieldStorage* storage;
+    int Nyr;
+    int Nxr;
+    int ncomp;
+    int cs;
+    bool periodic;
+};
+#endif //CLASS_SERIALDECOMPOSITION
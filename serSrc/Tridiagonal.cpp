@@ -0,0 +1,102 @@
+#include "Tridiagonal.h"
+
+/// Lines swept together: enough independent recurrences to hide latency, few enough streams
+static const int LINE_BLOCK = 32;
+
+/**
+ * @brief Constructor: allocates operators for lines of n cells
+ * @param n number of cells per line
+ * */
+Tridiagonal::Tridiagonal(int n) : n(n), r(0.0) {
+    pivot = new double[n];
+    upper = new double[n];
+}
+
+/**
+ * @brief Destructor: Deletes all allocated pointers in the class instance
+ * */
+Tridiagonal::~Tridiagonal() {
+    delete[] pivot;
+    delete[] upper;
+}
+
+/**
+ * @brief Factors I - rD (LU without pivoting, diagonally dominant)
+ * @param r diffusion number of the half-step, c*dt/(2*h^2)
+ * */
+void Tridiagonal::Factor(double r) {
+    this->r = r;
+
+    double b = 1.0 + 2.0*r;
+    pivot[0] = 1.0 / b;
+    upper[0] = -r * pivot[0];
+    for (int k = 1; k < n; k++) {
+        pivot[k] = 1.0 / (b + r*upper[k-1]);
+        upper[k] = -r * pivot[k];
+    }
+}
+
+/**
+ * @brief y = (I + rD) x for every line, swept cell by cell across a block of lines
+ * The cells just outside each line (ghost frame) enter the end equations
+ * @param x input lines
+ * @param y output lines, same layout as x
+ * @param inc distance between consecutive cells of a line
+ * @param nlines number of lines
+ * @param lineStride distance between consecutive lines
+ * */
+void Tridiagonal::Apply(const double* x, double* y, int inc, int nlines, int lineStride) const {
+    double rr = r;
+    double d = 1.0 - 2.0*r;
+    for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+        int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+        const double* xb = x + l0*lineStride;
+        double* yb = y + l0*lineStride;
+        for (int k = 0; k < n; k++) {
+            const double* xk = xb + k*inc;
+            double* yk = yb + k*inc;
+            for (int l = 0; l < nb; l++) {
+                yk[l*lineStride] = d*xk[l*lineStride] + rr*(xk[l*lineStride - inc] + xk[l*lineStride + inc]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief x = (I - rD)^-1 x for every line, in place
+ * Sweeps cell by cell across a block of lines, so lines that are adjacent in memory vectorise
+ * and the block stays in cache between elimination and substitution
+ * @param x lines, overwritten with the solution
+ * @param inc distance between consecutive cells of a line
+ * @param nlines number of lines
+ * @param lineStride distance between consecutive lines
+ * */
+void Tridiagonal::Solve(double* x, int inc, int nlines, int lineStride) const {
+    double rr = r;
+    for (int l0 = 0; l0 < nlines; l0 += LINE_BLOCK) {
+        int nb = (l0 + LINE_BLOCK < nlines) ? LINE_BLOCK : nlines - l0;
+        double* xb = x + l0*lineStride;
+
+        /// Forward elimination
+        double p0 = pivot[0];
+        for (int l = 0; l < nb; l++) {
+            xb[l*lineStride] *= p0;
+        }
+        for (int k = 1; k < n; k++) {
+            double* xk = xb + k*inc;
+            double pk = pivot[k];
+            for (int l = 0; l < nb; l++) {
+                xk[l*lineStride] = (xk[l*lineStride] + rr*xk[l*lineStride - inc]) * pk;
+            }
+        }
+
+        /// Back substitution
+        for (int k = n-2; k >= 0; k--) {
+            double* xk = xb + k*inc;
+            double uk = upper[k];
+            for (int l = 0; l < nb; l++) {
+                xk[l*lineStride] -= uk * xk[l*lineStride + inc];
+            }
+        }
+    }
+}
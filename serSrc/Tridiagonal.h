@@ -0,0 +1,26 @@
+#ifndef CLASS_TRIDIAGONAL
+#define CLASS_TRIDIAGONAL
+
+/**
+ * @class Tridiagonal
+ * @brief Half-steps of the ADI diffusion along one grid direction, I + rD and (I - rD)^-1,
+ * where D is the second difference [1 -2 1] with zero Dirichlet ends.
+ * Lines are handled in batches: element k of line l is x[l*lineStride + k*inc]
+ * */
+class Tridiagonal {
+public:
+    explicit Tridiagonal(int n);
+    ~Tridiagonal();
+
+    void Factor(double r);
+    void Apply(const double* x, double* y, int inc, int nlines, int lineStride) const;
+    void Solve(double* x, int inc, int nlines, int lineStride) const;
+private:
+    int n;
+    double r;
+
+    /// Thomas factors of I - rD: reciprocal pivots and scaled superdiagonal
+    double* pivot;
+    double* upper;
+};
+#endif //CLASS_TRIDIAGONAL
@@ -1,14 +1,80 @@
 #include <chrono>
 #include "Model.h"
 #include "Burgers.h"
+#include "BurgersBatch.h"
+#include "Ensemble.h"
 #include <iostream>
+#include <thread>
+
+typedef std::chrono::high_resolution_clock hrc;
+typedef std::chrono::milliseconds ms;
+typedef std::chrono::duration<double> fsec;
+
+/**
+ * @brief Worker of an ensemble: runs its share of the cases on a solver of its own
+ * @param &m model to copy
+ * @param batch cases per batch (4, 8), or 0 to run them one at a time
+ * @param k worker, of nthreads
+ * */
+static void RunWorker(const Model &m, int batch, EnsembleCase* cases, int n, int k, int nthreads) {
+    Model mk(m);
+    if (batch == 8) {
+        BurgersBatch<8> b(mk);
+        RunBatchedCases(b, cases, n, k, nthreads);
+    }
+    else if (batch == 4) {
+        BurgersBatch<4> b(mk);
+        RunBatchedCases(b, cases, n, k, nthreads);
+    }
+    else {
+        Burgers b(mk);
+        RunCases(b, mk, cases, n, k, nthreads);
+    }
+}
+
+/**
+ * @brief Runs the cases of the ensemble file on --threads workers and writes ensemble.txt
+ * Every worker owns a copy of the model and one solver, allocated once, and takes the cases
+ * (or the batches of --batch cases) round-robin
+ * */
+static int RunEnsemble(Model &m) {
+    EnsembleCase* cases;
+    int n = ReadEnsemble(m.GetEnsembleFile(), cases);
+    if (n < 0) {
+        std::cout << "ERROR: Cannot read ensemble file " << m.GetEnsembleFile() << std::endl;
+        return 1;
+    }
+    int batch = m.GetBatch();
+    if (batch > 0 && !m.CanBatch()) {
+        std::cout << "WARN: Batches need the Euler scheme, the upwind stencil, a uniform unrefined grid and a fixed time step, running cases one at a time" << std::endl;
+        batch = 0;
+    }
+    int units = (batch > 0) ? (n + batch - 1) / batch : n;
+    int nthreads = std::min(m.GetThreads(), std::max(units, 1));
+    m.PrintParameters();
+    std::cout << "Ensemble: " << n << " cases on " << nthreads << " threads" << std::endl;
+
+    hrc::time_point start = hrc::now();
+
+    std::thread* workers = new std::thread[nthreads];
+    for (int k = 0; k < nthreads; ++k) {
+        workers[k] = std::thread(RunWorker, std::cref(m), batch, cases, n, k, nthreads);
+    }
+    for (int k = 0; k < nthreads; ++k) workers[k].join();
+    delete[] workers;
+
+    hrc::time_point end = hrc::now();
+    fsec elapsed_seconds = end-start;
+    std::cout << "Time elapsed: " << elapsed_seconds.count() << " s" << std::endl;
+
+    WriteEnsemble("ensemble.txt", cases, n);
+    delete[] cases;
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
     Model m(argc, argv);
-
-    typedef std::chrono::high_resolution_clock hrc;
-    typedef std::chrono::milliseconds ms;
-    typedef std::chrono::duration<double> fsec;
+    if (m.IsEnsemble()) return RunEnsemble(m);
 
     Burgers b(m);
     // Call code to initialise the problem here;
@@ -25,6 +91,8 @@ int main(int argc, char* argv[]) {
     ms elapsed_ms = std::chrono::duration_cast<ms>(elapsed_seconds);
     std::cout << "Time elapsed: " << elapsed_seconds.count() << " s" << std::endl;
     std::cout << "Time elapsed: " << elapsed_ms.count() << " ms" << std::endl;
+    std::cout << "Time steps: " << b.GetSteps() << std::endl;
+    if (m.IsImplicit()) std::cout << "Solver iterations: " << b.GetSolverIterations() << std::endl;
 
     // Calculate final energy and write output
     b.SetEnergy();